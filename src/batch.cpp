@@ -0,0 +1,271 @@
+#include "batch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+template <typename T>
+T choose(const std::string& value, std::initializer_list<pair<const char*, T>> options) {
+	for (const auto& option : options) {
+		if (value == option.first) return option.second;
+	}
+	throw std::invalid_argument(value);
+}
+
+// Relative cost, only used to start the large jobs first. Point relaxation needs a number of
+// sweeps growing with the square of the grid size, the other solvers a roughly constant number.
+double estimatedCost(const BatchJob& job) {
+	if (job.kind == JobKind::Triangular) return job.points * std::sqrt(double(job.points));
+	double nodes = double(job.iMax) * job.jMax;
+	double size = max(job.iMax, job.jMax);
+	return job.settings.solver == Solver::GaussSeidel ? nodes * size * size : nodes * 100;
+}
+
+std::string describe(const BatchJob& job) {
+	std::ostringstream text;
+	if (job.kind == JobKind::Triangular) {
+		const char* clouds[] = { "uniform", "clusters", "lattice" };
+		const char* orders[] = { "bins", "hilbert", "brio" };
+		text << "triangular " << job.points << " " << clouds[int(job.cloud)] << " points "
+			<< orders[int(job.triangulation.order)];
+	}
+	else {
+		const char* solvers[] = { "gauss-seidel", "multigrid", "newton-krylov" };
+		text << "rectangular " << job.iMax << "x" << job.jMax << " " << solvers[int(job.settings.solver)]
+			<< (job.doublePrecision ? " double" : " float");
+	}
+	if (!job.output.empty()) text << " -> " << job.output;
+	return text.str();
+}
+
+// Runs one job, returns its number of grid points and sets details to anything worth reporting
+long long runJob(const BatchJob& job, std::string& details) {
+	if (job.kind == JobKind::Triangular) {
+		std::mt19937 gen(job.seed);
+		std::uniform_real_distribution<> dis(0, 5);
+		std::normal_distribution<> spread(0, 0.02);
+		vector<Node> centres;
+		for (int k = 0; k < 20; k++) centres.push_back({ float(dis(gen)), float(dis(gen)) });
+		int side = static_cast<int>(std::ceil(std::sqrt(double(job.points))));
+
+		vector<Node> points;
+		for (int i = 0; i < job.points; i++) {
+			if (job.cloud == PointCloud::Clusters) {
+				const Node& centre = centres[i % centres.size()];
+				points.push_back({ float(centre.x + spread(gen)), float(centre.y + spread(gen)) });
+			}
+			else if (job.cloud == PointCloud::Lattice) {
+				points.push_back({ float(i % side), float(i / side) });
+			}
+			else {
+				points.push_back({ float(dis(gen)), float(dis(gen)) });
+			}
+		}
+
+		Triangular grid(points, job.triangulation);
+		grid.delaunayTriangulate(job.output);
+		WalkStatistics walks = grid.getInsertionWalks();
+		std::ostringstream text;
+		text << ", walks of " << std::setprecision(3) << walks.mean() << " triangles on average, " << walks.longest << " at most";
+		details = text.str();
+		return job.points;
+	}
+
+	SolverSettings settings = job.settings;
+	settings.outputFile = job.output;
+	if (job.doublePrecision) {
+		Rectangular<double> grid(job.iMax, job.jMax, job.channel, settings);
+	}
+	else {
+		Rectangular<float> grid(job.iMax, job.jMax, job.channel, settings);
+	}
+	return (long long)job.iMax * job.jMax;
+}
+
+// Job numbers per worker, each queue behind its own lock. Owners and thieves both take from the
+// front, which holds the largest job left in a queue, so stealing keeps largest first.
+class WorkQueues {
+public:
+	explicit WorkQueues(int workers) : queues(workers) {}
+
+	void push(int worker, int job) { queues[worker].jobs.push_back(job); }
+
+	// Own queue first, then the others in turn
+	bool take(int worker, int& job) {
+		int count = static_cast<int>(queues.size());
+		for (int n = 0; n < count; n++) {
+			Queue& queue = queues[(worker + n) % count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty()) continue;
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			if (n > 0) steals++;
+			return true;
+		}
+		return false;
+	}
+
+	int stolen() const { return steals.load(); }
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<int> jobs;
+	};
+	vector<Queue> queues;
+	std::atomic<int> steals{ 0 };
+};
+
+}
+
+vector<BatchJob> readJobList(const std::string& filename) {
+	std::ifstream inFile(filename);
+	if (!inFile) {
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	vector<BatchJob> jobs;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(inFile, line)) {
+		lineNumber++;
+		std::istringstream tokens(line.substr(0, line.find('#')));
+		std::string kind;
+		if (!(tokens >> kind)) continue;
+
+		auto fail = [&](const std::string& message) {
+			throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": " + message);
+		};
+
+		BatchJob job;
+		job.settings.numThreads = 1;	// the batch is parallel over jobs
+		job.triangulation.numThreads = 1;
+		double bump = 0.1, bumpStart = 2.0, bumpEnd = 3.0, height = 1.0;
+		if (kind == "rectangular") {
+			if (!(tokens >> job.iMax >> job.jMax)) fail("expected iMax and jMax");
+		}
+		else if (kind == "triangular") {
+			job.kind = JobKind::Triangular;
+		}
+		else {
+			fail("unknown job kind " + kind);
+		}
+
+		std::string setting;
+		while (tokens >> setting) {
+			std::size_t equals = setting.find('=');
+			if (equals == std::string::npos) fail("expected key=value, got " + setting);
+			std::string key = setting.substr(0, equals), value = setting.substr(equals + 1);
+			try {
+				if (key == "output") job.output = value;
+				else if (key == "points") job.points = std::stoi(value);
+				else if (key == "cloud") {
+					job.cloud = choose<PointCloud>(value, { { "uniform", PointCloud::Uniform },
+						{ "clusters", PointCloud::Clusters }, { "lattice", PointCloud::Lattice } });
+				}
+				else if (key == "seed") job.seed = job.triangulation.seed = static_cast<unsigned>(std::stoul(value));
+				else if (key == "precision") job.doublePrecision = choose<bool>(value, { { "float", false }, { "double", true } });
+				else if (key == "solver") {
+					job.settings.solver = choose<Solver>(value, { { "gauss-seidel", Solver::GaussSeidel },
+						{ "multigrid", Solver::Multigrid }, { "newton-krylov", Solver::NewtonKrylov } });
+				}
+				else if (key == "sweep") {
+					job.settings.sweepMode = choose<SweepMode>(value, { { "lexicographic", SweepMode::Lexicographic },
+						{ "red-black", SweepMode::RedBlack }, { "line-sor", SweepMode::LineSOR }, { "tiled", SweepMode::Tiled } });
+				}
+				else if (key == "tolerance") job.settings.tolerance = std::stof(value);
+				else if (key == "order") {
+					job.triangulation.order = choose<PointOrder>(value, { { "bins", PointOrder::Bins },
+						{ "hilbert", PointOrder::Hilbert }, { "brio", PointOrder::Brio } });
+				}
+				else if (key == "threads") job.settings.numThreads = job.triangulation.numThreads = std::stoi(value);
+				else if (key == "bump") bump = std::stod(value);
+				else if (key == "bumpstart") bumpStart = std::stod(value);
+				else if (key == "bumpend") bumpEnd = std::stod(value);
+				else if (key == "height") height = std::stod(value);
+				else if (key == "xw") job.channel.x_W = std::stod(value);
+				else if (key == "xe") job.channel.x_E = std::stod(value);
+				else fail("unknown key " + key);
+			}
+			catch (const std::logic_error&) {
+				fail("bad value for " + key + ": " + value);
+			}
+		}
+
+		if (job.kind == JobKind::Rectangular && (job.iMax < 3 || job.jMax < 3)) fail("a grid needs at least 3 x 3 nodes");
+		if (job.kind == JobKind::Triangular && job.points < 3) fail("a triangulation needs at least 3 points");
+		job.channel.south = sineBump(0.0, bump, bumpStart, bumpEnd);
+		job.channel.north = sineBump(height, -bump, bumpStart, bumpEnd);
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+BatchSummary runBatch(vector<BatchJob> jobs, int threads) {
+	using Clock = std::chrono::steady_clock;
+	if (threads <= 0) threads = max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	threads = max(1, min(threads, static_cast<int>(jobs.size())));
+
+	// Largest first, dealt out round robin so every worker starts on one of the largest
+	vector<int> order(jobs.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return estimatedCost(jobs[a]) > estimatedCost(jobs[b]); });
+	WorkQueues queues(threads);
+	for (std::size_t n = 0; n < order.size(); n++) {
+		queues.push(static_cast<int>(n % threads), order[n]);
+	}
+
+	BatchSummary summary;
+	summary.jobs = static_cast<int>(jobs.size());
+	if (jobs.empty()) return summary;
+	std::mutex reportMutex;
+	Clock::time_point start = Clock::now();
+
+	auto work = [&](int worker) {
+		int index;
+		while (queues.take(worker, index)) {
+			const BatchJob& job = jobs[index];
+			Clock::time_point jobStart = Clock::now();
+			long long nodes = 0;
+			std::string error, details;
+			try {
+				nodes = runJob(job, details);
+			}
+			catch (const std::exception& e) {
+				error = e.what();
+			}
+			double seconds = std::chrono::duration<double>(Clock::now() - jobStart).count();
+
+			std::lock_guard<std::mutex> lock(reportMutex);
+			summary.jobSeconds += seconds;
+			if (error.empty()) {
+				summary.nodes += nodes;
+				cout << "Job " << index + 1 << " (" << describe(job) << "): " << seconds << " s" << details << "\n";
+			}
+			else {
+				summary.failed++;
+				cout << "Job " << index + 1 << " (" << describe(job) << ") failed: " << error << "\n";
+			}
+		}
+	};
+
+	vector<std::thread> workers;
+	for (int t = 1; t < threads; t++) workers.emplace_back(work, t);
+	work(0);
+	for (auto& worker : workers) worker.join();
+	summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	cout << "Batch: " << summary.jobs << " jobs, " << summary.failed << " failed, " << threads << " threads, "
+		<< summary.seconds << " s" << endl;
+	cout << "Throughput: " << (summary.jobs - summary.failed) / summary.seconds << " jobs/s, " << summary.nodes / summary.seconds
+		<< " points/s, job time " << summary.jobSeconds << " s, parallel efficiency "
+		<< 100 * summary.jobSeconds / (summary.seconds * threads) << "%, " << queues.stolen() << " jobs stolen" << endl;
+	return summary;
+}
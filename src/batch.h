@@ -0,0 +1,59 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "rectangular.h"
+#include "triangular.h"
+
+enum class JobKind {
+	Rectangular,	// elliptic grid of a bump channel
+	Triangular		// Delaunay triangulation of a generated point cloud
+};
+
+// Point sets for triangulation jobs, the last two are hard on the insertion order
+enum class PointCloud {
+	Uniform,	// uniform in the 5 x 5 square
+	Clusters,	// 20 normal clusters of standard deviation 0.02 in that square
+	Lattice		// rows of a square lattice of unit spacing, as grid aligned as input gets
+};
+
+// One grid of a batch, as read from a line of a job list
+struct BatchJob {
+	JobKind kind = JobKind::Rectangular;
+	std::string output;
+
+	// Rectangular
+	int iMax = 26, jMax = 6;
+	Channel channel = bumpChannel();
+	bool doublePrecision = false;
+	SolverSettings settings;
+
+	// Triangular
+	int points = 100;
+	PointCloud cloud = PointCloud::Uniform;
+	unsigned seed = 0;	// of the points and of the Brio rounds
+	TriangulationSettings triangulation;
+};
+
+struct BatchSummary {
+	int jobs = 0, failed = 0;
+	long long nodes = 0;	// grid points of the jobs that finished
+	double seconds = 0;		// wall time of the batch
+	double jobSeconds = 0;	// sum of the wall times of the jobs
+};
+
+// One job per line, blank lines and everything after # ignored:
+//   rectangular <iMax> <jMax> [key=value ...]
+//   triangular [key=value ...]
+// Rectangular keys: output, precision (float, double), solver (gauss-seidel, multigrid,
+// newton-krylov), sweep (lexicographic, red-black, line-sor, tiled), tolerance, threads (per job,
+// default 1), bump, bumpstart, bumpend (the sine bump of both walls), height (of the channel),
+// xw, xe. Triangular keys: output, points, cloud (uniform, clusters, lattice), seed, order (bins,
+// hilbert, brio), threads.
+vector<BatchJob> readJobList(const std::string& filename);
+
+// Runs the jobs headless on threads workers (0 every hardware thread), each worker taking one job
+// at a time. Jobs are dealt out largest estimated cost first and idle workers steal from the
+// others. A failing job is reported and skipped. Prints a line per job and a throughput summary.
+BatchSummary runBatch(vector<BatchJob> jobs, int threads = 0);
+
+#endif // BATCH_H
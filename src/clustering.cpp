@@ -0,0 +1,77 @@
+#include "clustering.h"
+#include <stdexcept>
+
+static vector<double> geometricNodes(double firstCell, bool twoSided, int intervals) {
+	// Spacing firstCell * r^m, m counted from the nearest clustered end; the ratio r that makes the
+	// intervals sum to 1 is found by bisection, the sum grows monotonically with r
+	auto exponent = [&](int m) { return twoSided ? min(m, intervals - 1 - m) : m; };
+	auto span = [&](double ratio) {
+		double sum = 0;
+		for (int m = 0; m < intervals; m++) sum += firstCell * pow(ratio, exponent(m));
+		return sum;
+	};
+
+	double low = 1e-3, high = 1e3;
+	for (int iteration = 0; iteration < 200; iteration++) {
+		double ratio = sqrt(low * high);
+		if (span(ratio) < 1) low = ratio;
+		else high = ratio;
+	}
+	double ratio = sqrt(low * high);
+
+	vector<double> nodes(intervals + 1, 0.0);
+	for (int m = 0; m < intervals; m++) nodes[m + 1] = nodes[m] + firstCell * pow(ratio, exponent(m));
+	for (double& node : nodes) node /= nodes[intervals];
+	return nodes;
+}
+
+vector<double> clusterNodes(const Clustering& clustering, int nodes) {
+	if (nodes < 2) {
+		throw std::invalid_argument("A grid direction needs at least 2 nodes");
+	}
+	int intervals = nodes - 1;
+	if (clustering.stretching == Stretching::Geometric) {
+		return geometricNodes(clustering.firstCell, clustering.twoSided, intervals);
+	}
+
+	if (clustering.stretching == Stretching::Roberts && clustering.strength <= 1) {
+		throw std::invalid_argument("Roberts stretching needs a strength above 1");
+	}
+
+	double delta = clustering.strength;
+	double beta = clustering.strength;
+	double ratio = (beta + 1) / (beta - 1);
+
+	vector<double> positions(nodes);
+	for (int m = 0; m < nodes; m++) {
+		double s = double(m) / double(intervals);
+		double t = s;
+		if (clustering.stretching == Stretching::Tanh) {
+			t = clustering.twoSided ? 0.5 * (1 + tanh(delta * (s - 0.5)) / tanh(delta / 2))
+				: 1 + tanh(delta * (s - 1)) / tanh(delta);
+		}
+		else if (clustering.stretching == Stretching::Roberts) {
+			if (clustering.twoSided) {
+				double power = pow(ratio, 2 * s - 1);
+				t = ((beta + 1) * power + 1 - beta) / (2 * (1 + power));
+			}
+			else {
+				double power = pow(ratio, 1 - s);
+				t = ((beta + 1) - (beta - 1) * power) / (power + 1);
+			}
+		}
+		positions[m] = t;
+	}
+	positions[0] = 0.0;
+	positions[intervals] = 1.0;
+	return positions;
+}
+
+vector<double> stretchFactors(const vector<double>& nodes) {
+	vector<double> factors(nodes.size(), 0.0);
+	for (std::size_t m = 1; m + 1 < nodes.size(); m++) {
+		double before = nodes[m] - nodes[m - 1], after = nodes[m + 1] - nodes[m];
+		factors[m] = -(after - before) / (after + before);
+	}
+	return factors;
+}
@@ -0,0 +1,30 @@
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+#include "geometry.h"
+
+enum class Stretching {
+	Uniform,
+	Tanh,		// hyperbolic tangent, strength is the tanh argument delta (larger clusters harder)
+	Roberts,	// Roberts transformation, strength is beta > 1 (closer to 1 clusters harder)
+	Geometric	// spacing grows by a constant ratio away from a first cell of size firstCell
+};
+
+// Node distribution along one grid direction
+struct Clustering {
+	Stretching stretching = Stretching::Uniform;
+	double strength = 2.0;
+	double firstCell = 0.01;	// Geometric only, as a fraction of the whole span
+	bool twoSided = true;		// cluster towards both ends, otherwise towards the first one only
+};
+
+// Positions in [0, 1] of the given number of nodes, increasing from 0 to 1
+vector<double> clusterNodes(const Clustering& clustering, int nodes);
+
+// Per node s = -(d+ - d-) / (d+ + d-), with d- / d+ the spacing before / after it and 0 at both
+// ends. Weighting the stencil neighbours before / after a node by (1 - s) / (1 + s) adds the
+// control function -x_xixi / x_xi, which makes nodes at these positions a solution of the
+// one-dimensional equation, i.e. the elliptic solver keeps the clustering.
+vector<double> stretchFactors(const vector<double>& nodes);
+
+#endif // CLUSTERING_H
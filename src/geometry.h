@@ -12,26 +12,29 @@
 
 using std::vector, std::cout, std::endl, std::setw, std::max, std::min;
 
-struct Node {
-    float x, y;
+template <typename Real>
+struct BasicNode {
+    Real x, y;
 
-    Node operator+(const Node& other) const {
+    BasicNode operator+(const BasicNode& other) const {
         return { x + other.x, y + other.y };
     }
 
-    Node operator-(const Node& other) const {
+    BasicNode operator-(const BasicNode& other) const {
         return { x - other.x, y - other.y };
     }
 
-    float dot(const Node& other) const {
+    Real dot(const BasicNode& other) const {
         return (x * other.x) + (y * other.y);
     }
 
-    float cross(const Node& other) const {
+    Real cross(const BasicNode& other) const {
         return (x * other.y) - (y * other.x);
     }
 };
 
+using Node = BasicNode<float>;
+
 struct Polygon {
     vector<int> vertices;
     vector<int> edges;
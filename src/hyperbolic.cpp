@@ -0,0 +1,113 @@
+#include "hyperbolic.h"
+#include <stdexcept>
+
+namespace {
+
+// 2 x 2 block of the layer system, row major
+struct Block {
+	double a, b, c, d;
+
+	Block operator+(const Block& o) const { return { a + o.a, b + o.b, c + o.c, d + o.d }; }
+	Block operator-(const Block& o) const { return { a - o.a, b - o.b, c - o.c, d - o.d }; }
+	Block operator*(const Block& o) const {
+		return { a * o.a + b * o.c, a * o.b + b * o.d, c * o.a + d * o.c, c * o.b + d * o.d };
+	}
+	BasicNode<double> operator*(const BasicNode<double>& v) const { return { a * v.x + b * v.y, c * v.x + d * v.y }; }
+	Block scaled(double s) const { return { a * s, b * s, c * s, d * s }; }
+	Block inverse() const {
+		double det = a * d - b * c;
+		return { d / det, -b / det, -c / det, a / det };
+	}
+};
+
+const Block identity = { 1.0, 0.0, 0.0, 1.0 };
+
+}
+
+template <typename Real>
+void Hyperbolic<Real>::march() {
+	if (iMax < 3 || jMax < 2) {
+		throw std::invalid_argument("Hyperbolic marching needs at least 3 x 2 nodes");
+	}
+
+	// Marching step of every layer, geometric from the wall and summing to height
+	vector<double> steps(jMax - 1, settings.height / (jMax - 1));
+	if (settings.stretching != 1.0) {
+		double first = settings.height * (settings.stretching - 1) / (pow(settings.stretching, jMax - 1) - 1);
+		for (int j = 0; j < jMax - 1; j++) steps[j] = first * pow(settings.stretching, j);
+	}
+
+	vector<BasicNode<double>> layer(iMax), next(iMax);
+	for (int i = 0; i < iMax; i++) {
+		double x = x_W + (x_E - x_W) * i / (iMax - 1);
+		layer[i] = { x, wall.y(x) };
+	}
+
+	points.assign(std::size_t(iMax) * jMax, {});
+	auto store = [&](int j) {
+		for (int i = 0; i < iMax; i++) points[std::size_t(j) * iMax + i] = { Real(layer[i].x), Real(layer[i].y) };
+	};
+	store(0);
+
+	double explicitSmoothing = settings.dissipation;
+	double implicitSmoothing = 2 * settings.dissipation;
+	vector<Block> lower(iMax), diagonal(iMax), upper(iMax);
+	vector<BasicNode<double>> rhs(iMax);
+
+	for (int j = 0; j < jMax - 1; j++) {
+		// Linearised about the current layer r0 with r_eta0 = ds n, the unit normal step, so the new
+		// cells get area V = ds |r_xi|. With C = B^-1 A the layer update dr solves
+		// (I + C d/dxi - e_i d2/dxi2) dr = B^-1 (0, 2V) - C r0_xi + e_e d2 r0/dxi2
+		for (int i = 1; i < iMax - 1; i++) {
+			BasicNode<double> rXi = { (layer[i + 1].x - layer[i - 1].x) / 2, (layer[i + 1].y - layer[i - 1].y) / 2 };
+			double lengthSq = rXi.dot(rXi);
+			double area = steps[j] * sqrt(lengthSq);
+			BasicNode<double> rEta = { -rXi.y * area / lengthSq, rXi.x * area / lengthSq };
+
+			Block A = { rEta.x, rEta.y, rEta.y, -rEta.x };
+			Block inverseB = Block{ rXi.x, -rXi.y, rXi.y, rXi.x }.scaled(1 / lengthSq);
+			Block C = inverseB * A;
+
+			lower[i] = C.scaled(-0.5) - identity.scaled(implicitSmoothing);
+			diagonal[i] = identity.scaled(1 + 2 * implicitSmoothing);
+			upper[i] = C.scaled(0.5) - identity.scaled(implicitSmoothing);
+
+			BasicNode<double> source = inverseB * BasicNode<double>{ 0.0, 2 * area };
+			BasicNode<double> advection = C * rXi;
+			BasicNode<double> curvature = layer[i + 1] + layer[i - 1] - layer[i] - layer[i];
+			rhs[i] = { source.x - advection.x + explicitSmoothing * curvature.x,
+				source.y - advection.y + explicitSmoothing * curvature.y };
+		}
+
+		// The sides keep their x and take the y step of their neighbour
+		const Block keepY = { 0.0, 0.0, 0.0, 1.0 };
+		diagonal[0] = identity;
+		upper[0] = keepY.scaled(-1);
+		rhs[0] = { 0.0, 0.0 };
+		lower[iMax - 1] = keepY.scaled(-1);
+		diagonal[iMax - 1] = identity;
+		rhs[iMax - 1] = { 0.0, 0.0 };
+
+		// Block Thomas algorithm
+		for (int i = 1; i < iMax; i++) {
+			Block m = lower[i] * diagonal[i - 1].inverse();
+			diagonal[i] = diagonal[i] - m * upper[i - 1];
+			rhs[i] = rhs[i] - m * rhs[i - 1];
+		}
+		next[iMax - 1] = diagonal[iMax - 1].inverse() * rhs[iMax - 1];
+		for (int i = iMax - 2; i >= 0; i--) {
+			next[i] = diagonal[i].inverse() * (rhs[i] - upper[i] * next[i + 1]);
+		}
+
+		for (int i = 0; i < iMax; i++) layer[i] = layer[i] + next[i];
+		store(j + 1);
+	}
+}
+
+template <typename Real>
+void Hyperbolic<Real>::writePointsTecplot(const std::string& filename) {
+	writeGridTecplot(filename, getGridPoints());
+}
+
+template class Hyperbolic<float>;
+template class Hyperbolic<double>;
@@ -0,0 +1,47 @@
+#ifndef HYPERBOLIC_H
+#define HYPERBOLIC_H
+
+#include "geometry.h"
+#include "rectangular.h"
+
+struct HyperbolicSettings {
+	double height = 0.5;		// distance marched away from the wall
+	double stretching = 1.0;	// ratio of successive marching steps, > 1 clusters layers at the wall
+	double dissipation = 0.1;	// explicit smoothing along each layer, the implicit one is twice that
+};
+
+// Single-pass alternative to the elliptic solver for near-wall grids. Marches jMax - 1 layers away
+// from the south wall of the channel, each layer from one 2 x 2 block tridiagonal solve of the
+// linearised orthogonality and cell area equations (Steger & Chaussee). The west and east sides
+// stay on x = x_W and x = x_E. The north wall is not seen, so height should stay below the channel,
+// and the last layer is free: the elliptic grid of the same region is that of a channel with a flat
+// north wall height above the south wall's base.
+// Points and rectangles are numbered as in Rectangular.
+template <typename Real = float>
+class Hyperbolic : public Geometry {
+public:
+	Hyperbolic(int iMax, int jMax, Channel channel = bumpChannel(), HyperbolicSettings settings = {})
+		: iMax(iMax), jMax(jMax), settings(settings), wall(channel.south), x_W(channel.x_W), x_E(channel.x_E) {
+		march();
+		rectangles = structuredRectangles(iMax, jMax);
+	}
+
+	vector<BasicNode<Real>> getPoints() { return points; }
+	GridPoints<Real> getGridPoints() { return { iMax, jMax, points }; }
+	vector<Rectangle> getRectangles() { return rectangles; }
+
+	void writePointsTecplot(const std::string& filename);
+
+private:
+	int iMax, jMax;
+	HyperbolicSettings settings;
+	WallShape wall;
+	double x_W, x_E;
+
+	vector<BasicNode<Real>> points;
+	vector<Rectangle> rectangles;
+
+	void march();
+};
+
+#endif // HYPERBOLIC_H
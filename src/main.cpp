@@ -2,9 +2,25 @@
 #include "triangular.h"
 #include "rectangular.h"
 #include "renderer.h"
+#include "batch.h"
 #include <random>
 
-int main() {
+int main(int argc, char* argv[]) {
+
+    // ### HEADLESS BATCH MODE ###
+    // grid_generator --batch <job list> [threads], see batch.h for the job list format
+
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        try {
+            int threads = argc >= 4 ? std::stoi(argv[3]) : 0;
+            BatchSummary summary = runBatch(readJobList(argv[2]), threads);
+            return summary.failed == 0 ? 0 : 1;
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << endl;
+            return 1;
+        }
+    }
     
     /*
 
@@ -34,7 +50,10 @@ int main() {
 
     // ### RECTANGULAR GRID EXAMPLE ###
 
-    Rectangular rectGrid = Rectangular(26, 6);
+    Telemetry telemetry(0.5);
+    SolverSettings settings;
+    settings.telemetry = &telemetry;
+    Rectangular rectGrid = Rectangular(26, 6, settings);
 
     Renderer renderer = Renderer(DrawMode::Rectangles);
     renderer.setScaleInterval(1);
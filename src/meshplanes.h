@@ -0,0 +1,80 @@
+#ifndef MESHPLANES_H
+#define MESHPLANES_H
+
+#include "geometry.h"
+#include <new>
+
+// Minimal allocator handing out 64-byte (cache line) aligned storage
+template <typename T, std::size_t Align = 64>
+struct AlignedAllocator {
+	using value_type = T;
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+	template <typename U>
+	struct rebind { using other = AlignedAllocator<U, Align>; };
+
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+	}
+	void deallocate(T* p, std::size_t) {
+		::operator delete(p, std::align_val_t(Align));
+	}
+
+	bool operator==(const AlignedAllocator&) const { return true; }
+	bool operator!=(const AlignedAllocator&) const { return false; }
+};
+
+// Structure-of-arrays storage for the nodes of an iMax x jMax structured grid. x and y are
+// separate aligned planes; every row starts on a cache line and is padded by at least one value,
+// so vector kernels may load a full register past the last node of a row.
+template <typename Real>
+class MeshPlanes {
+public:
+	static constexpr int rowAlign = 64 / sizeof(Real); // values per 64-byte cache line
+
+	MeshPlanes() = default;
+	MeshPlanes(int iMax, int jMax)
+		: iMax(iMax), jMax(jMax), stride((iMax + rowAlign) / rowAlign * rowAlign),
+		  xs(std::size_t(stride) * jMax, Real(0)), ys(std::size_t(stride) * jMax, Real(0)) {}
+
+	int iMax = 0, jMax = 0;
+	int stride = 0; // padded row length
+
+	Real* x() { return xs.data(); }
+	Real* y() { return ys.data(); }
+	const Real* x() const { return xs.data(); }
+	const Real* y() const { return ys.data(); }
+
+	int index(int i, int j) const { return j * stride + i; }
+	BasicNode<Real> node(int k) const { return { xs[k], ys[k] }; }
+	void setNode(int k, BasicNode<Real> p) { xs[k] = p.x; ys[k] = p.y; }
+
+	// Row-major array of structures without padding, as used by the renderer and file writers
+	vector<BasicNode<Real>> toNodes() const {
+		vector<BasicNode<Real>> nodes;
+		nodes.reserve(std::size_t(iMax) * jMax);
+		for (int j = 0; j < jMax; j++) {
+			for (int i = 0; i < iMax; i++) {
+				nodes.push_back(node(index(i, j)));
+			}
+		}
+		return nodes;
+	}
+
+	void assign(const vector<BasicNode<Real>>& nodes) {
+		for (int j = 0; j < jMax; j++) {
+			for (int i = 0; i < iMax; i++) {
+				setNode(index(i, j), nodes[j * iMax + i]);
+			}
+		}
+	}
+
+private:
+	vector<Real, AlignedAllocator<Real>> xs;
+	vector<Real, AlignedAllocator<Real>> ys;
+};
+
+#endif // MESHPLANES_H
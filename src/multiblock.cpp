@@ -0,0 +1,150 @@
+#include "multiblock.h"
+#include <stdexcept>
+
+template <typename Real>
+MultiBlock<Real>::MultiBlock(int jMax, vector<BlockDefinition> definitions, vector<BlockInterface> interfaces, SolverSettings settings)
+	: interfaces(interfaces), settings(settings) {
+	if (settings.solver != Solver::GaussSeidel) {
+		throw std::invalid_argument("MultiBlock relaxes with Gauss-Seidel only");
+	}
+	if (settings.sweepMode != SweepMode::Lexicographic && settings.sweepMode != SweepMode::Tiled) {
+		throw std::invalid_argument("MultiBlock sweeps lexicographically or tiled only");
+	}
+	if (settings.mixedPrecision || settings.qualityInterval > 0 || settings.snapshots
+		|| !settings.checkpointPath.empty() || settings.checkpointSeconds > 0) {
+		throw std::invalid_argument("MultiBlock supports no mixed precision, quality stop, snapshots or checkpoints");
+	}
+
+	int blockCount = static_cast<int>(definitions.size());
+	vector<bool> westInterface(blockCount, false), eastInterface(blockCount, false);
+	for (const BlockInterface& face : interfaces) {
+		if (face.west < 0 || face.west >= blockCount || face.east < 0 || face.east >= blockCount || face.west == face.east) {
+			throw std::invalid_argument("Interface between unknown blocks");
+		}
+		if (eastInterface[face.west] || westInterface[face.east]) {
+			throw std::invalid_argument("Block side on more than one interface");
+		}
+		eastInterface[face.west] = true;
+		westInterface[face.east] = true;
+	}
+
+	// Columns of the whole grid, counting each overlap once
+	int columns = 0;
+	for (int b = 0; b < blockCount; b++) {
+		if (definitions[b].iMax < 3) {
+			throw std::invalid_argument("Every block needs at least 3 columns");
+		}
+		columns += definitions[b].iMax;
+		blocks.emplace_back(new Rectangular<Real>(definitions[b].iMax, jMax, definitions[b].channel, settings,
+			std::move(definitions[b].xiNodes), westInterface[b], eastInterface[b]));
+	}
+	columns -= 2 * static_cast<int>(interfaces.size());
+	dXi = Real(1) / Real(columns - 1);
+	dEta = Real(1) / Real(jMax - 1);
+
+	solve(15000);
+	for (auto& block : blocks) {
+		block->createRectangles();
+	}
+}
+
+template <typename Real>
+vector<BlockDefinition> MultiBlock<Real>::splitChannel(int iMax, int blockCount, const Channel& channel, const SolverSettings& settings) {
+	// Block b owns the columns [owned[b], owned[b + 1]) of the whole grid and reaches one column
+	// into each neighbour
+	if (blockCount < 1 || iMax < 2 * blockCount + 1) {
+		throw std::invalid_argument("Too many blocks for the number of columns");
+	}
+	vector<double> xi = clusterNodes(settings.xiClustering, iMax);
+
+	vector<BlockDefinition> definitions;
+	for (int b = 0; b < blockCount; b++) {
+		int first = b == 0 ? 0 : b * iMax / blockCount - 1;
+		int last = b == blockCount - 1 ? iMax - 1 : (b + 1) * iMax / blockCount;
+
+		BlockDefinition definition;
+		definition.iMax = last - first + 1;
+		definition.channel = channel;
+		definition.channel.x_W = channel.x_W + xi[first] * (channel.x_E - channel.x_W);
+		definition.channel.x_E = channel.x_W + xi[last] * (channel.x_E - channel.x_W);
+		for (int c = first; c <= last; c++) {
+			definition.xiNodes.push_back((xi[c] - xi[first]) / (xi[last] - xi[first]));
+		}
+		definitions.push_back(std::move(definition));
+	}
+	return definitions;
+}
+
+template <typename Real>
+vector<BlockInterface> MultiBlock<Real>::chainInterfaces(int blockCount) {
+	vector<BlockInterface> interfaces;
+	for (int b = 0; b + 1 < blockCount; b++) {
+		interfaces.push_back({ b, b + 1 });
+	}
+	return interfaces;
+}
+
+template <typename Real>
+void MultiBlock<Real>::exchange() {
+	for (const BlockInterface& face : interfaces) {
+		MeshPlanes<Real>& west = blocks[face.west]->mesh;
+		MeshPlanes<Real>& east = blocks[face.east]->mesh;
+		int last = west.iMax - 1;
+		for (int j = 0; j < west.jMax; j++) {
+			west.setNode(west.index(last, j), east.node(east.index(1, j)));
+			east.setNode(east.index(0, j), west.node(west.index(last - 1, j)));
+		}
+	}
+}
+
+template <typename Real>
+int MultiBlock<Real>::solve(int maxIterations) {
+	ThreadPool pool(settings.numThreads);
+	int sweeps = settings.sweepMode == SweepMode::Tiled ? max(settings.tileSweeps, 1) : 1;
+	vector<Real> blockChange(blocks.size(), Real(0));
+
+	Telemetry* telemetry = settings.telemetry;
+	if (telemetry) telemetry->begin("MultiBlock");
+
+	exchange();
+	bool converged = false;
+	int iteration = 0;
+	Real maxChange = Real(0);
+	while (!converged) {
+		pool.parallelFor(0, blockCount(), [&](int begin, int end, int) {
+			for (int b = begin; b < end; b++) {
+				Rectangular<Real>& block = *blocks[b];
+				Real change = Real(0);
+				block.enforceBCs(dEta);
+				if (sweeps > 1) block.enforceICsTiled(dXi, dEta, sweeps, change);
+				else block.enforceICs(dXi, dEta, change);
+				blockChange[b] = change;
+			}
+		});
+		exchange();
+
+		maxChange = Real(0);
+		for (Real change : blockChange) {
+			maxChange = max(maxChange, change);
+		}
+
+		converged = maxChange < settings.tolerance || iteration > maxIterations;
+		iteration += sweeps;
+		if (telemetry) telemetry->post(iteration, maxChange);
+	}
+	if (telemetry) telemetry->end(iteration, maxChange);
+	if (!settings.outputFile.empty()) writePointsTecplot(settings.outputFile);
+	return iteration;
+}
+
+template <typename Real>
+void MultiBlock<Real>::writePointsTecplot(const std::string& filename) {
+	vector<GridPoints<Real>> zones;
+	for (auto& block : blocks) {
+		zones.push_back(block->getGridPoints());
+	}
+	writeGridTecplot(filename, zones, "Block");
+}
+
+template class MultiBlock<float>;
+template class MultiBlock<double>;
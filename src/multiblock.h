@@ -0,0 +1,59 @@
+#ifndef MULTIBLOCK_H
+#define MULTIBLOCK_H
+
+#include "geometry.h"
+#include "rectangular.h"
+#include "threadpool.h"
+#include <memory>
+
+// One block of a MultiBlock. channel.x_W / x_E are the x of its first and last column.
+struct BlockDefinition {
+	int iMax;
+	Channel channel;
+	vector<double> xiNodes;	// optional node positions in [0, 1] along xi, else settings.xiClustering
+};
+
+// The east side of block west meets the west side of block east with an overlap of one cell:
+// the last two columns of west are the first two of east. Each block relaxes the first of these
+// columns it owns and takes the other one from its neighbour.
+struct BlockInterface {
+	int west, east;
+};
+
+// Several Rectangular blocks of a common jMax, relaxed in parallel on a thread pool, one block per
+// task, with the interface columns exchanged after every pass. xi is spaced as in a single block
+// spanning all of them, so a channel cut into blocks converges to the grid of the whole channel.
+// Blocks sweep lexicographically, or Tiled with tileSweeps sweeps per exchange. Other solvers and
+// sweep modes, mixed precision, quality stops, snapshots and checkpoints throw std::invalid_argument.
+template <typename Real = float>
+class MultiBlock : public Geometry {
+public:
+	MultiBlock(int jMax, vector<BlockDefinition> definitions, vector<BlockInterface> interfaces, SolverSettings settings = {});
+
+	// iMax x jMax channel cut along xi into blockCount blocks of about equal width
+	MultiBlock(int iMax, int jMax, int blockCount, Channel channel = bumpChannel(), SolverSettings settings = {})
+		: MultiBlock(jMax, splitChannel(iMax, blockCount, channel, settings), chainInterfaces(blockCount), settings) {}
+
+	int blockCount() const { return static_cast<int>(blocks.size()); }
+	vector<BasicNode<Real>> getPoints(int block) { return blocks[block]->getPoints(); }
+	vector<Rectangle> getRectangles(int block) { return blocks[block]->getRectangles(); }
+
+	// Relaxes until the largest change of a pass is below the tolerance, returns the passes used
+	int solve(int maxIterations);
+
+	// One zone per block
+	void writePointsTecplot(const std::string& filename);
+
+private:
+	vector<std::unique_ptr<Rectangular<Real>>> blocks;
+	vector<BlockInterface> interfaces;
+	SolverSettings settings;
+	Real dXi, dEta;
+
+	static vector<BlockDefinition> splitChannel(int iMax, int blockCount, const Channel& channel, const SolverSettings& settings);
+	static vector<BlockInterface> chainInterfaces(int blockCount);
+
+	void exchange();
+};
+
+#endif // MULTIBLOCK_H
@@ -0,0 +1,439 @@
+#include "multigrid.h"
+#include "rectangular.h"
+#include "stencil.h"
+#include "clustering.h"
+#include <limits>
+
+// Neighbour sum of the normalised stencil at interior node k; returns the normalisation factor.
+// Evaluated in double: the residual divides the difference of this sum and the node by the
+// factor, which is of order h^2, and in float that cancellation swamps the fine grid residual.
+template <typename Real>
+static double stencilSum(const GridLevel<Real>& level, const MeshPlanes<Real>& u, int i, int j, BasicNode<double>& sum) {
+	const Real* x = u.x();
+	const Real* y = u.y();
+	int s = u.stride;
+	int k = u.index(i, j);
+	double dXi = level.dXi, dEta = level.dEta;
+
+	BasicNode<double> dX = { (double(x[k + 1]) - x[k - 1]) / (2 * dXi), (double(x[k + s]) - x[k - s]) / (2 * dEta) };
+	BasicNode<double> dY = { (double(y[k + 1]) - y[k - 1]) / (2 * dXi), (double(y[k + s]) - y[k - s]) / (2 * dEta) };
+
+	double coeff[8];
+	double mult = level.stretchXi.empty() ? winslowCoeff(dX, dY, dXi, dEta, coeff)
+		: winslowCoeff(dX, dY, dXi, dEta, coeff, double(level.stretchXi[i]), double(level.stretchEta[j]));
+
+	const int offsets[8] = { -1 - s, -s, 1 - s, -1, 1, -1 + s, s, 1 + s };
+	sum = { 0.0, 0.0 };
+	for (int m = 0; m < 8; m++) {
+		sum.x += coeff[m] * x[k + offsets[m]];
+		sum.y += coeff[m] * y[k + offsets[m]];
+	}
+	return mult;
+}
+
+// Nodes of the next coarser level along a direction with the given node count and spacing: about
+// half the intervals, as long as at least 3 interior nodes are left. Fewer hardly resolve the walls
+// and their corrections stall the cycles. A direction already spaced over twice as wide as the
+// other is left as it is: point smoothing only damps errors that are smooth along the strongly
+// coupled, finely spaced direction, so only that one may coarsen (semi-coarsening).
+static int coarseNodes(int nodes, double spacing, double otherSpacing) {
+	return nodes >= 8 && spacing <= 2 * otherSpacing ? nodes / 2 + 1 : nodes;
+}
+
+// Where each of to evenly spaced nodes lies between from evenly spaced nodes over the same span
+static Interpolation interpolation(int from, int to) {
+	Interpolation transfer;
+	for (int k = 0; k < to; k++) {
+		// Position k * (from - 1) / (to - 1) in from nodes, exact in integers
+		long long scaled = static_cast<long long>(k) * (from - 1);
+		int first = static_cast<int>(scaled / (to - 1));
+		double weight = double(scaled % (to - 1)) / double(to - 1);
+		if (first == from - 1) {
+			first--;
+			weight = 1.0;
+		}
+		transfer.first.push_back(first);
+		transfer.weight.push_back(weight);
+	}
+	return transfer;
+}
+
+// Per coarse node, the weights up gives it over the fine nodes
+static vector<double> targetSums(const Interpolation& up, int coarse) {
+	vector<double> sums(coarse, 0.0);
+	for (std::size_t k = 0; k < up.first.size(); k++) {
+		sums[up.first[k]] += 1 - up.weight[k];
+		sums[up.first[k] + 1] += up.weight[k];
+	}
+	return sums;
+}
+
+// Bilinear interpolation at node (i, j) of one level from the nodes value(I, J) of another, given
+// where (i, j) lies between them along each direction. Nodes of weight 0 are not read.
+template <typename Real, typename Value>
+static BasicNode<Real> bilinear(const Interpolation& xi, const Interpolation& eta, int i, int j, Value value) {
+	int I = xi.first[i], J = eta.first[j];
+	double wx = xi.weight[i], wy = eta.weight[j];
+	BasicNode<double> v = { 0.0, 0.0 };
+	for (int b = 0; b < 2; b++) {
+		for (int a = 0; a < 2; a++) {
+			double w = (a ? wx : 1 - wx) * (b ? wy : 1 - wy);
+			if (w == 0.0) continue;
+			BasicNode<Real> node = value(I + a, J + b);
+			v.x += w * node.x;
+			v.y += w * node.y;
+		}
+	}
+	return { Real(v.x), Real(v.y) };
+}
+
+template <typename Real>
+Multigrid<Real>::Multigrid(Rectangular<Real>& grid) : grid(grid) {
+	int iMax = grid.iMax, jMax = grid.jMax;
+	double xScale = 1, yScale = 1;	// fine grid intervals per level interval
+
+	// Mean channel width and height, for the physical spacing of every level
+	double width = grid.x_E - grid.x_W, height = 0;
+	const MeshPlanes<Real>& mesh = grid.mesh;
+	for (int i = 0; i < iMax; i++) {
+		height += std::fabs(double(mesh.y()[mesh.index(i, jMax - 1)]) - mesh.y()[mesh.index(i, 0)]) / iMax;
+	}
+
+	while (true) {
+		GridLevel<Real> level;
+		level.iMax = iMax;
+		level.jMax = jMax;
+		level.dXi = Real(1) / Real(iMax - 1);
+		level.dEta = Real(1) / Real(jMax - 1);
+		level.rhs = MeshPlanes<double>(iMax, jMax);
+		level.residual = MeshPlanes<double>(iMax, jMax);
+		if (!levels.empty()) {
+			level.points = MeshPlanes<Real>(iMax, jMax);
+			level.restricted = MeshPlanes<Real>(iMax, jMax);
+		}
+
+		// Coarse levels take the factors of the clustered positions at their own nodes
+		if (!grid.stretchXi.empty()) {
+			auto positions = [](const vector<double>& nodes, int count, double scale) {
+				vector<double> at;
+				for (int k = 0; k < count; k++) {
+					double fine = min(k * scale, double(nodes.size() - 1));
+					int first = min(static_cast<int>(fine), static_cast<int>(nodes.size()) - 2);
+					at.push_back(nodes[first] + (fine - first) * (nodes[first + 1] - nodes[first]));
+				}
+				return at;
+			};
+			for (double factor : stretchFactors(positions(grid.xiNodes, iMax, xScale))) level.stretchXi.push_back(Real(factor));
+			for (double factor : stretchFactors(positions(grid.etaNodes, jMax, yScale))) level.stretchEta.push_back(Real(factor));
+		}
+
+		// Coarsen while the coarse level still has interior nodes
+		double hx = width / (iMax - 1), hy = height / (jMax - 1);
+		int coarseI = coarseNodes(iMax, hx, hy), coarseJ = coarseNodes(jMax, hy, hx);
+		bool coarsest = coarseI == iMax && coarseJ == jMax;
+		if (!coarsest) {
+			level.xiDown = interpolation(iMax, coarseI);
+			level.etaDown = interpolation(jMax, coarseJ);
+			level.xiUp = interpolation(coarseI, iMax);
+			level.etaUp = interpolation(coarseJ, jMax);
+			level.xiUpSum = targetSums(level.xiUp, coarseI);
+			level.etaUpSum = targetSums(level.etaUp, coarseJ);
+		}
+		levels.push_back(std::move(level));
+		if (coarsest) break;
+
+		xScale *= double(iMax - 1) / double(coarseI - 1);
+		yScale *= double(jMax - 1) / double(coarseJ - 1);
+		iMax = coarseI;
+		jMax = coarseJ;
+	}
+
+	if (grid.settings.sweepMode == SweepMode::RedBlack) {
+		pool = std::make_unique<ThreadPool>(grid.settings.numThreads);
+	}
+}
+
+template <typename Real>
+MeshPlanes<Real>& Multigrid<Real>::pointsOf(int l) {
+	return l == 0 ? grid.mesh : levels[l].points;
+}
+
+template <typename Real>
+Real Multigrid<Real>::relax(int l) {
+	GridLevel<Real>& level = levels[l];
+	MeshPlanes<Real>& u = pointsOf(l);
+	int iMax = level.iMax;
+
+	auto relaxNode = [&](int i, int j) {
+		int k = u.index(i, j);
+		BasicNode<double> sum;
+		double mult = stencilSum(level, u, i, j, sum);
+		BasicNode<double> f = level.rhs.node(level.rhs.index(i, j));
+		BasicNode<Real> old = u.node(k);
+		BasicNode<Real> updated = { Real(sum.x - mult * f.x), Real(sum.y - mult * f.y) };
+		u.setNode(k, updated);
+		return (Real) max(fabs(updated.x - old.x), fabs(updated.y - old.y));
+	};
+
+	Real maxChange = Real(0);
+	if (!pool) {
+		for (int j = 1; j < level.jMax - 1; j++) {
+			for (int i = 1; i < iMax - 1; i++) {
+				maxChange = max(maxChange, relaxNode(i, j));
+			}
+		}
+		return maxChange;
+	}
+
+	// Same (i, j) parity colouring as Rectangular::enforceICsRedBlack
+	vector<Real> threadMax(pool->size(), Real(0));
+	for (int colour = 0; colour < 4; colour++) {
+		int iStart = 1 + colour % 2;
+		int jStart = 1 + colour / 2;
+		int rows = (level.jMax - jStart) / 2;
+
+		pool->parallelFor(0, rows, [&](int rowBegin, int rowEnd, int thread) {
+			Real localMax = threadMax[thread];
+			for (int row = rowBegin; row < rowEnd; row++) {
+				int j = jStart + 2 * row;
+				for (int i = iStart; i < iMax - 1; i += 2) {
+					localMax = max(localMax, relaxNode(i, j));
+				}
+			}
+			threadMax[thread] = localMax;
+		});
+	}
+
+	for (Real change : threadMax) {
+		maxChange = max(maxChange, change);
+	}
+	return maxChange;
+}
+
+template <typename Real>
+void Multigrid<Real>::updateBoundary(int l) {
+	// Coarse levels have no wall geometry of their own. Wall nodes slide tangentially with their
+	// interior neighbour, i.e. the correction satisfies a homogeneous Neumann condition.
+	GridLevel<Real>& level = levels[l];
+	Real* x = level.points.x();
+	Real* y = level.points.y();
+	const Real* x0 = level.restricted.x();
+	const Real* y0 = level.restricted.y();
+	int s = level.points.stride;
+
+	for (int i = 1; i < level.iMax - 1; i++) {
+		int south = level.points.index(i, 0), north = level.points.index(i, level.jMax - 1);
+		x[south] = x0[south] + (x[south + s] - x0[south + s]);
+		x[north] = x0[north] + (x[north - s] - x0[north - s]);
+	}
+	for (int j = 1; j < level.jMax - 1; j++) {
+		int west = level.points.index(0, j), east = level.points.index(level.iMax - 1, j);
+		y[west] = y0[west] + (y[west + 1] - y0[west + 1]);
+		y[east] = y0[east] + (y[east - 1] - y0[east - 1]);
+	}
+}
+
+template <typename Real>
+Real Multigrid<Real>::smooth(int l) {
+	if (l == 0) grid.enforceBCs(levels[0].dEta);
+	Real maxChange = relax(l);
+	if (l > 0) updateBoundary(l);
+	return maxChange;
+}
+
+template <typename Real>
+void Multigrid<Real>::computeResidual(int l) {
+	GridLevel<Real>& level = levels[l];
+	MeshPlanes<Real>& u = pointsOf(l);
+
+	for (int j = 1; j < level.jMax - 1; j++) {
+		for (int i = 1; i < level.iMax - 1; i++) {
+			int k = level.residual.index(i, j);
+			BasicNode<double> sum;
+			double mult = stencilSum(level, u, i, j, sum);
+			BasicNode<double> f = level.rhs.node(k);
+			BasicNode<Real> p = u.node(u.index(i, j));
+			level.residual.setNode(k, { f.x - (sum.x - p.x) / mult, f.y - (sum.y - p.y) / mult });
+		}
+	}
+}
+
+template <typename Real>
+void Multigrid<Real>::inject(int l) {
+	// Interpolates level l - 1 at the nodes of level l, a copy where the nodes coincide
+	GridLevel<Real>& fine = levels[l - 1];
+	GridLevel<Real>& coarse = levels[l];
+	MeshPlanes<Real>& u = pointsOf(l - 1);
+
+	for (int J = 0; J < coarse.jMax; J++) {
+		for (int I = 0; I < coarse.iMax; I++) {
+			BasicNode<Real> p = bilinear<Real>(fine.xiDown, fine.etaDown, I, J, [&](int i, int j) { return u.node(u.index(i, j)); });
+			coarse.points.setNode(coarse.points.index(I, J), p);
+		}
+	}
+	coarse.restricted = coarse.points;
+}
+
+template <typename Real>
+void Multigrid<Real>::restrictTo(int l) {
+	// Injection of the solution and full weighting of the residual from level l - 1 onto level l.
+	// The weighting is the transpose of prolong, scaled to weights summing to 1 at every coarse node.
+	GridLevel<Real>& fine = levels[l - 1];
+	GridLevel<Real>& coarse = levels[l];
+	inject(l);
+
+	MeshPlanes<double>& r = coarse.residual;
+	for (int J = 0; J < coarse.jMax; J++) {
+		for (int I = 0; I < coarse.iMax; I++) {
+			r.setNode(r.index(I, J), { 0.0, 0.0 });
+		}
+	}
+	for (int j = 1; j < fine.jMax - 1; j++) {
+		for (int i = 1; i < fine.iMax - 1; i++) {
+			BasicNode<double> fr = fine.residual.node(fine.residual.index(i, j));
+			int I = fine.xiUp.first[i], J = fine.etaUp.first[j];
+			double wx = fine.xiUp.weight[i], wy = fine.etaUp.weight[j];
+			for (int b = 0; b < 2; b++) {
+				for (int a = 0; a < 2; a++) {
+					double w = (a ? wx : 1 - wx) * (b ? wy : 1 - wy);
+					if (w == 0.0) continue;
+					int k = r.index(I + a, J + b);
+					r.x()[k] += w * fr.x;
+					r.y()[k] += w * fr.y;
+				}
+			}
+		}
+	}
+
+	for (int J = 1; J < coarse.jMax - 1; J++) {
+		for (int I = 1; I < coarse.iMax - 1; I++) {
+			double scale = 1 / (fine.xiUpSum[I] * fine.etaUpSum[J]);
+			int k = r.index(I, J);
+
+			// FAS right-hand side: coarse operator of the restricted solution plus the restricted residual
+			BasicNode<double> sum;
+			double mult = stencilSum(coarse, coarse.points, I, J, sum);
+			BasicNode<Real> p = coarse.points.node(coarse.points.index(I, J));
+			coarse.rhs.setNode(coarse.rhs.index(I, J), { (sum.x - p.x) / mult + scale * r.x()[k], (sum.y - p.y) / mult + scale * r.y()[k] });
+		}
+	}
+}
+
+template <typename Real>
+BasicNode<Real> Multigrid<Real>::prolong(int l, int i, int j) {
+	// Bilinear interpolation of the correction of level l at node (i, j) of level l - 1
+	GridLevel<Real>& fine = levels[l - 1];
+	GridLevel<Real>& coarse = levels[l];
+
+	return bilinear<Real>(fine.xiUp, fine.etaUp, i, j, [&](int I, int J) {
+		int k = coarse.points.index(I, J);
+		return coarse.points.node(k) - coarse.restricted.node(k);
+	});
+}
+
+template <typename Real>
+void Multigrid<Real>::correct(int l) {
+	// Wall nodes only take the tangential part of the correction, the wall itself is re-imposed
+	// by the boundary conditions of the finer level
+	GridLevel<Real>& level = levels[l];
+	MeshPlanes<Real>& u = pointsOf(l);
+	for (int j = 0; j < level.jMax; j++) {
+		for (int i = 0; i < level.iMax; i++) {
+			bool xWall = i == 0 || i == level.iMax - 1;
+			bool yWall = j == 0 || j == level.jMax - 1;
+			if (xWall && yWall) continue;
+
+			int k = u.index(i, j);
+			BasicNode<Real> e = prolong(l + 1, i, j);
+			if (!xWall) u.x()[k] += e.x;
+			if (!yWall) u.y()[k] += e.y;
+		}
+	}
+}
+
+template <typename Real>
+void Multigrid<Real>::cycle(int l) {
+	GridLevel<Real>& level = levels[l];
+	bool coarsest = l == levelCount() - 1;
+
+	if (coarsest && l > 0) {
+		for (int s = 0; s < 2 * (level.iMax + level.jMax); s++) smooth(l);
+		return;
+	}
+
+	for (int s = 0; s < grid.settings.preSmooth; s++) smooth(l);
+
+	if (!coarsest) {
+		computeResidual(l);
+		restrictTo(l + 1);
+		cycle(l + 1);
+		correct(l);
+	}
+
+	for (int s = 0; s < grid.settings.postSmooth; s++) {
+		Real change = smooth(l);
+		if (l == 0) lastChange = change;
+	}
+}
+
+template <typename Real>
+Real Multigrid<Real>::vCycle() {
+	// Same metric as gaussSeibel: the max change of the last sweep on the finest level
+	lastChange = Real(0);
+	cycle(0);
+	return lastChange;
+}
+
+template <typename Real>
+void Multigrid<Real>::fullMultigrid() {
+	// Nested iteration: solve the coarsest problem first and carry what each level changed up to
+	// the next finer one as its initial guess. Every level starts from the finest one injected, and
+	// its walls take the change along them, as the nodes slide along the walls on coarse levels.
+	int coarsest = levelCount() - 1;
+	for (int l = 1; l <= coarsest; l++) {
+		inject(l);
+	}
+
+	for (int l = coarsest; l > 0; l--) {
+		levels[l].rhs = MeshPlanes<double>(levels[l].iMax, levels[l].jMax);
+		cycle(l);
+		correct(l - 1);
+	}
+}
+
+template <typename Real>
+Real Multigrid<Real>::roundoffFloor() {
+	// A sweep keeps moving nodes by a few units in the last place of their coordinates
+	const MeshPlanes<Real>& u = grid.mesh;
+	Real extent = Real(0);
+	for (int j = 0; j < grid.jMax; j++) {
+		for (int i = 0; i < grid.iMax; i++) {
+			int k = u.index(i, j);
+			extent = max(extent, max(std::fabs(u.x()[k]), std::fabs(u.y()[k])));
+		}
+	}
+	return 8 * std::numeric_limits<Real>::epsilon() * extent;
+}
+
+template <typename Real>
+int Multigrid<Real>::solve(int maxCycles) {
+	if (grid.settings.fullMultigrid) fullMultigrid();
+
+	Telemetry* telemetry = grid.settings.telemetry;
+	if (telemetry) telemetry->begin("Multigrid");
+
+	int cycles = 0;
+	Real maxChange = Real(0);
+	Real target = max(Real(grid.settings.tolerance), roundoffFloor());
+	while (cycles < maxCycles) {
+		maxChange = vCycle();
+		cycles++;
+		if (telemetry) telemetry->post(cycles, maxChange);
+		if (maxChange < target) break;
+	}
+	if (telemetry) telemetry->end(cycles, maxChange);
+	return cycles;
+}
+
+template class Multigrid<float>;
+template class Multigrid<double>;
@@ -0,0 +1,81 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include "geometry.h"
+#include "meshplanes.h"
+#include "threadpool.h"
+#include <memory>
+
+template <typename Real>
+class Rectangular;
+
+// Linear interpolation along one grid direction: node k of one level lies between nodes first[k]
+// and first[k] + 1 of the other, weight being the share of the latter
+struct Interpolation {
+	vector<int> first;
+	vector<double> weight;
+};
+
+template <typename Real>
+struct GridLevel {
+	int iMax, jMax;
+	Real dXi, dEta;
+
+	// Towards the next coarser level, per direction: its nodes between the nodes here (down), the
+	// nodes here between its nodes (up), and per coarse node the up weights it is the target of
+	Interpolation xiDown, etaDown, xiUp, etaUp;
+	vector<double> xiUpSum, etaUpSum;
+
+	MeshPlanes<Real> points;		// empty on the finest level, which solves on Rectangular::mesh
+	MeshPlanes<Real> restricted;	// points as restricted from the finer level, for the FAS correction
+	MeshPlanes<double> rhs;			// in double for every Real, see stencilSum
+	MeshPlanes<double> residual;
+
+	// Control function stretch factors per column and row, empty without clustering
+	vector<Real> stretchXi, stretchEta;
+};
+
+// Full approximation scheme (FAS) multigrid for the nonlinear elliptic grid equations.
+// A direction with n >= 8 nodes gets n / 2 + 1 evenly spaced nodes on the next coarser level,
+// unless its cells are over twice as wide as along the other direction. E.g. 129 x 33 coarsens
+// down to 9 x 5, 26 x 6 to 8 x 6 and 2000 x 2000 first along eta only. Coarse nodes lie on every
+// second node for an even interval count and between nodes otherwise, the transfers interpolate
+// linearly.
+template <typename Real>
+class Multigrid {
+public:
+	Multigrid(Rectangular<Real>& grid);
+
+	int levelCount() const { return static_cast<int>(levels.size()); }
+
+	// Runs V-cycles until the last fine sweep changes less than the tolerance, or than the round-off
+	// floor of Real where that is larger (about 5e-6 for float on the default channel), returns
+	// the cycles used
+	int solve(int maxCycles);
+	Real vCycle();
+	void fullMultigrid();
+
+	// Changes a converged solve in Real still makes, 8 ulp of the largest coordinate
+	Real roundoffFloor();
+
+private:
+	Rectangular<Real>& grid;
+	vector<GridLevel<Real>> levels;
+	std::unique_ptr<ThreadPool> pool;
+
+	MeshPlanes<Real>& pointsOf(int l);
+
+	Real lastChange = 0;
+
+	Real relax(int l);
+	void updateBoundary(int l);
+	Real smooth(int l);
+	void computeResidual(int l);
+	void inject(int l);
+	void restrictTo(int l);
+	BasicNode<Real> prolong(int l, int i, int j);
+	void correct(int l);
+	void cycle(int l);
+};
+
+#endif // MULTIGRID_H
@@ -0,0 +1,365 @@
+#include "newtonkrylov.h"
+#include "rectangular.h"
+#include "stencil.h"
+#include <limits>
+
+template <typename Real>
+NewtonKrylov<Real>::NewtonKrylov(Rectangular<Real>& grid) : grid(grid), fallback(grid) {
+	int iMax = grid.iMax, jMax = grid.jMax;
+	dXi = Real(1) / Real(iMax - 1);
+	dEta = Real(1) / Real(jMax - 1);
+
+	basis.assign(max(grid.settings.krylovDim, 1) + 1, MeshPlanes<Real>(iMax, jMax));
+	residualPlanes = MeshPlanes<Real>(iMax, jMax);
+	trial = residualPlanes;
+	trialResidual = residualPlanes;
+	boundaryPlanes = residualPlanes;
+	work = residualPlanes;
+	preconditioned = residualPlanes;
+	step = residualPlanes;
+
+	std::size_t size = std::size_t(residualPlanes.stride) * jMax;
+	cW.assign(size, Real(0));
+	cS.assign(size, Real(0));
+	corner.assign(size, Real(0));
+	wallStep.assign(grid.boundary.size(), 1);
+	wallSlope.assign(grid.boundary.size(), Real(0));
+}
+
+template <typename Real>
+Real NewtonKrylov<Real>::dot(const MeshPlanes<Real>& a, const MeshPlanes<Real>& b) const {
+	double sum = 0;
+	for (int j = 0; j < a.jMax; j++) {
+		for (int i = 0; i < a.iMax; i++) {
+			int k = a.index(i, j);
+			sum += double(a.x()[k]) * b.x()[k] + double(a.y()[k]) * b.y()[k];
+		}
+	}
+	return Real(sum);
+}
+
+template <typename Real>
+Real NewtonKrylov<Real>::maxNorm(const MeshPlanes<Real>& a) const {
+	Real norm = Real(0);
+	for (int j = 0; j < a.jMax; j++) {
+		for (int i = 0; i < a.iMax; i++) {
+			int k = a.index(i, j);
+			norm = max(norm, (Real) max(fabs(a.x()[k]), fabs(a.y()[k])));
+		}
+	}
+	return norm;
+}
+
+template <typename Real>
+void NewtonKrylov<Real>::axpy(Real alpha, const MeshPlanes<Real>& a, MeshPlanes<Real>& b) const {
+	// b += alpha * a
+	for (int j = 0; j < a.jMax; j++) {
+		for (int i = 0; i < a.iMax; i++) {
+			int k = a.index(i, j);
+			b.x()[k] += alpha * a.x()[k];
+			b.y()[k] += alpha * a.y()[k];
+		}
+	}
+}
+
+template <typename Real>
+void NewtonKrylov<Real>::residual(const MeshPlanes<Real>& u, MeshPlanes<Real>& F) {
+	// Boundary rows: u minus u with the boundary conditions applied, zero for nodes they leave alone
+	boundaryPlanes = u;
+	grid.enforceBCs(boundaryPlanes, dEta);
+
+	const Real* x = u.x();
+	const Real* y = u.y();
+	int s = u.stride;
+	const int offsets[8] = { -1 - s, -s, 1 - s, -1, 1, -1 + s, s, 1 + s };
+
+	for (int j = 0; j < u.jMax; j++) {
+		for (int i = 0; i < u.iMax; i++) {
+			int k = u.index(i, j);
+			if (i == 0 || i == u.iMax - 1 || j == 0 || j == u.jMax - 1) {
+				F.setNode(k, u.node(k) - boundaryPlanes.node(k));
+				continue;
+			}
+
+			BasicNode<Real> dX = { (x[k + 1] - x[k - 1]) / (2 * dXi), (x[k + s] - x[k - s]) / (2 * dEta) };
+			BasicNode<Real> dY = { (y[k + 1] - y[k - 1]) / (2 * dXi), (y[k + s] - y[k - s]) / (2 * dEta) };
+			Real coeff[8];
+			if (grid.stretchXi.empty()) winslowCoeff(dX, dY, dXi, dEta, coeff);
+			else winslowCoeff(dX, dY, dXi, dEta, coeff, grid.stretchXi[i], grid.stretchEta[j]);
+
+			BasicNode<Real> r = u.node(k);
+			for (int m = 0; m < 8; m++) {
+				r.x -= coeff[m] * x[k + offsets[m]];
+				r.y -= coeff[m] * y[k + offsets[m]];
+			}
+			F.setNode(k, r);
+		}
+	}
+}
+
+template <typename Real>
+void NewtonKrylov<Real>::freeze(const MeshPlanes<Real>& u) {
+	// Picard linearisation at u: interior stencil coefficients as in enforceICsMixed, and per wall
+	// node whether it copies x from one row in (flat) or two rows in with the slope (bump)
+	const Real* x = u.x();
+	const Real* y = u.y();
+	int s = u.stride;
+
+	for (int j = 1; j < u.jMax - 1; j++) {
+		for (int i = 1; i < u.iMax - 1; i++) {
+			int k = u.index(i, j);
+			BasicNode<Real> dX = { (x[k + 1] - x[k - 1]) / (2 * dXi), (x[k + s] - x[k - s]) / (2 * dEta) };
+			BasicNode<Real> dY = { (y[k + 1] - y[k - 1]) / (2 * dXi), (y[k + s] - y[k - s]) / (2 * dEta) };
+			Real coeff[8];
+			if (grid.stretchXi.empty()) winslowCoeff(dX, dY, dXi, dEta, coeff);
+			else winslowCoeff(dX, dY, dXi, dEta, coeff, grid.stretchXi[i], grid.stretchEta[j]);
+			cW[k] = (coeff[3] + coeff[4]) / 2;
+			cS[k] = (coeff[1] + coeff[6]) / 2;
+			corner[k] = coeff[2];
+		}
+	}
+
+	boundaryPlanes = u;
+	grid.enforceBCs(boundaryPlanes, dEta);
+	for (std::size_t n = 0; n < grid.boundary.size(); n++) {
+		int wall = grid.boundary[n].wall;
+		if (wall == 0) continue;
+
+		const WallShape& shape = wall == 1 ? grid.south : grid.north;
+		Real bx = boundaryPlanes.x()[grid.boundary[n].k];
+		bool bump = bx >= shape.xBegin && bx <= shape.xEnd;
+		wallStep[n] = bump ? 2 : 1;
+		wallSlope[n] = bump ? Real(shape.slope(bx)) : Real(0);
+	}
+}
+
+template <typename Real>
+void NewtonKrylov<Real>::precondition(const MeshPlanes<Real>& r, MeshPlanes<Real>& e) {
+	// Gauss-Seidel sweeps from e = 0 on the frozen linearisation (I - C) e = r, visiting the
+	// boundary first as gaussSeibel does. The derivative of the wall slope is neglected.
+	Real* eX = e.x();
+	Real* eY = e.y();
+	const Real* rX = r.x();
+	const Real* rY = r.y();
+	int s = e.stride;
+
+	for (int j = 0; j < e.jMax; j++) {
+		for (int i = 0; i < e.iMax; i++) {
+			e.setNode(e.index(i, j), r.node(e.index(i, j)));
+		}
+	}
+
+	for (int sweep = 0; sweep < grid.settings.preconditionSweeps; sweep++) {
+		for (std::size_t n = 0; n < grid.boundary.size(); n++) {
+			const auto& node = grid.boundary[n];
+			int k = node.k;
+			if (node.wall != 0) {
+				eX[k] = rX[k] + eX[k + wallStep[n] * node.wall * s];
+				eY[k] = rY[k] + wallSlope[n] * eX[k];
+			}
+			if (node.side != 0) {
+				eY[k] = rY[k] + eY[k + node.side];
+			}
+		}
+
+		for (int j = 1; j < e.jMax - 1; j++) {
+			for (int i = 1; i < e.iMax - 1; i++) {
+				int k = e.index(i, j);
+				eX[k] = cW[k] * (eX[k - 1] + eX[k + 1]) + cS[k] * (eX[k - s] + eX[k + s])
+					+ corner[k] * (eX[k + 1 - s] + eX[k - 1 + s] - eX[k - 1 - s] - eX[k + 1 + s]) + rX[k];
+				eY[k] = cW[k] * (eY[k - 1] + eY[k + 1]) + cS[k] * (eY[k - s] + eY[k + s])
+					+ corner[k] * (eY[k + 1 - s] + eY[k - 1 + s] - eY[k - 1 - s] - eY[k + 1 + s]) + rY[k];
+			}
+		}
+	}
+}
+
+template <typename Real>
+void NewtonKrylov<Real>::jacobianTimes(const MeshPlanes<Real>& v, MeshPlanes<Real>& Jv) {
+	// Forward difference of F around the current points, with the usual step
+	// sqrt(eps (1 + |u|)) / |v|
+	const MeshPlanes<Real>& u = grid.mesh;
+	Real vNorm = std::sqrt(dot(v, v));
+	if (vNorm == Real(0)) {
+		Jv = MeshPlanes<Real>(u.iMax, u.jMax);
+		return;
+	}
+	Real epsilon = std::sqrt(std::numeric_limits<Real>::epsilon() * (1 + std::sqrt(dot(u, u)))) / vNorm;
+
+	trial = u;
+	axpy(epsilon, v, trial);
+	residual(trial, trialResidual);
+
+	for (int j = 0; j < u.jMax; j++) {
+		for (int i = 0; i < u.iMax; i++) {
+			int k = u.index(i, j);
+			Jv.setNode(k, { (trialResidual.x()[k] - residualPlanes.x()[k]) / epsilon,
+				(trialResidual.y()[k] - residualPlanes.y()[k]) / epsilon });
+		}
+	}
+}
+
+template <typename Real>
+int NewtonKrylov<Real>::gmres(Real forcing, MeshPlanes<Real>& s) {
+	// Restarted GMRES for J s = -F with right preconditioning, until |J s + F| <= forcing |F|.
+	// Returns the number of Krylov iterations.
+	int m = static_cast<int>(basis.size()) - 1;
+	Real target = forcing * std::sqrt(dot(residualPlanes, residualPlanes));
+	s = MeshPlanes<Real>(s.iMax, s.jMax);
+
+	vector<Real> H(std::size_t(m + 1) * m), cs(m), sn(m), g(m + 1), coefficients(m);
+	auto h = [&](int row, int column) -> Real& { return H[std::size_t(row) * m + column]; };
+
+	int iterations = 0;
+	for (int restart = 0; restart < max(grid.settings.krylovRestarts, 1); restart++) {
+		// r = -F - J s
+		MeshPlanes<Real>& r = basis[0];
+		if (restart == 0) {
+			r = MeshPlanes<Real>(s.iMax, s.jMax);
+		}
+		else {
+			jacobianTimes(s, r);
+			for (int j = 0; j < r.jMax; j++) {
+				for (int i = 0; i < r.iMax; i++) {
+					int k = r.index(i, j);
+					r.setNode(k, { -r.x()[k], -r.y()[k] });
+				}
+			}
+		}
+		axpy(Real(-1), residualPlanes, r);
+
+		Real beta = std::sqrt(dot(r, r));
+		if (beta <= target || beta == Real(0)) break;
+		for (int j = 0; j < r.jMax; j++) {
+			for (int i = 0; i < r.iMax; i++) {
+				int k = r.index(i, j);
+				r.setNode(k, { r.x()[k] / beta, r.y()[k] / beta });
+			}
+		}
+		std::fill(g.begin(), g.end(), Real(0));
+		g[0] = beta;
+
+		int used = 0;
+		while (used < m) {
+			int j = used;
+			precondition(basis[j], preconditioned);
+			jacobianTimes(preconditioned, basis[j + 1]);
+			iterations++;
+
+			// Modified Gram-Schmidt
+			for (int i = 0; i <= j; i++) {
+				h(i, j) = dot(basis[j + 1], basis[i]);
+				axpy(-h(i, j), basis[i], basis[j + 1]);
+			}
+			h(j + 1, j) = std::sqrt(dot(basis[j + 1], basis[j + 1]));
+			if (h(j + 1, j) > Real(0)) {
+				Real scale = Real(1) / h(j + 1, j);
+				MeshPlanes<Real>& w = basis[j + 1];
+				for (int b = 0; b < w.jMax; b++) {
+					for (int a = 0; a < w.iMax; a++) {
+						int k = w.index(a, b);
+						w.setNode(k, { w.x()[k] * scale, w.y()[k] * scale });
+					}
+				}
+			}
+
+			// Givens rotations keep the Hessenberg matrix triangular
+			for (int i = 0; i < j; i++) {
+				Real upper = cs[i] * h(i, j) + sn[i] * h(i + 1, j);
+				h(i + 1, j) = -sn[i] * h(i, j) + cs[i] * h(i + 1, j);
+				h(i, j) = upper;
+			}
+			Real radius = std::hypot(h(j, j), h(j + 1, j));
+			cs[j] = radius > Real(0) ? h(j, j) / radius : Real(1);
+			sn[j] = radius > Real(0) ? h(j + 1, j) / radius : Real(0);
+			h(j, j) = radius;
+			h(j + 1, j) = Real(0);
+			g[j + 1] = -sn[j] * g[j];
+			g[j] = cs[j] * g[j];
+
+			used++;
+			if (fabs(g[j + 1]) <= target || radius == Real(0)) break;
+		}
+
+		// s += M^-1 V y with H y = g
+		for (int i = used - 1; i >= 0; i--) {
+			Real sum = g[i];
+			for (int c = i + 1; c < used; c++) sum -= h(i, c) * coefficients[c];
+			coefficients[i] = h(i, i) != Real(0) ? sum / h(i, i) : Real(0);
+		}
+		work = MeshPlanes<Real>(s.iMax, s.jMax);
+		for (int i = 0; i < used; i++) axpy(coefficients[i], basis[i], work);
+		precondition(work, preconditioned);
+		axpy(Real(1), preconditioned, s);
+
+		if (fabs(g[used]) <= target) break;
+	}
+	return iterations;
+}
+
+template <typename Real>
+int NewtonKrylov<Real>::solve(int maxSteps) {
+	// Newton only converges from close by, nested iteration gets there cheaply
+	if (grid.settings.fullMultigrid) fallback.fullMultigrid();
+
+	MeshPlanes<Real>& u = grid.mesh;
+	residual(u, residualPlanes);
+	Real norm = std::sqrt(dot(residualPlanes, residualPlanes));
+	Real previousNorm = norm;
+
+	Telemetry* telemetry = grid.settings.telemetry;
+	if (telemetry) telemetry->begin("Newton-Krylov");
+
+	// F of a converged float grid is no smaller than the round-off of its coordinates
+	Real target = max(Real(grid.settings.tolerance), fallback.roundoffFloor());
+
+	int steps = 0;
+	Real maxResidual = maxNorm(residualPlanes);
+	while (maxResidual >= target && steps < maxSteps) {
+
+		// Eisenstat-Walker forcing, tightening quadratically with the residual, but never asking
+		// for more than the tolerance needs
+		Real forcing = Real(0.5);
+		if (steps > 0) forcing = min(forcing, Real(0.9) * (norm / previousNorm) * (norm / previousNorm));
+		forcing = max(forcing, Real(0.1) * target / maxResidual);
+
+		freeze(u);
+		gmres(forcing, step);
+
+		// Backtracking line search on |F| with the Armijo condition
+		Real lambda = Real(1);
+		bool accepted = false;
+		Real trialNorm = norm;
+		for (int halving = 0; halving < 8 && !accepted; halving++) {
+			trial = u;
+			axpy(lambda, step, trial);
+			residual(trial, trialResidual);
+			trialNorm = std::sqrt(dot(trialResidual, trialResidual));
+			accepted = trialNorm <= (1 - Real(1e-4) * lambda) * norm;
+			if (!accepted) lambda /= 2;
+		}
+
+		if (accepted) {
+			std::swap(u, trial);
+			std::swap(residualPlanes, trialResidual);
+		}
+		else {
+			// F is only piecewise smooth, wall nodes switch between the flat and the bump condition
+			// and the snapped bump edges move. Where the Newton direction does not descend, take
+			// a multigrid cycle instead.
+			fallback.vCycle();
+			residual(u, residualPlanes);
+			lambda = Real(0);
+		}
+		previousNorm = norm;
+		norm = std::sqrt(dot(residualPlanes, residualPlanes));
+		maxResidual = maxNorm(residualPlanes);
+		steps++;
+		if (telemetry) telemetry->post(steps, maxResidual);
+	}
+	if (telemetry) telemetry->end(steps, maxResidual);
+	return steps;
+}
+
+template class NewtonKrylov<float>;
+template class NewtonKrylov<double>;
@@ -0,0 +1,55 @@
+#ifndef NEWTONKRYLOV_H
+#define NEWTONKRYLOV_H
+
+#include "geometry.h"
+#include "meshplanes.h"
+#include "multigrid.h"
+
+template <typename Real>
+class Rectangular;
+
+// Jacobian-free Newton-Krylov solver for the nonlinear grid equations. The unknowns are all
+// nodes, the residual is F(u) = u - G(u) with G one Jacobi update of the interior stencil and
+// one application of the boundary conditions, so F = 0 is the fixed point gaussSeibel converges
+// to. Each Newton step solves J s = -F inexactly with restarted GMRES, where J v is a finite
+// difference of F, right-preconditioned by Gauss-Seidel sweeps of the frozen-coefficient
+// (Picard) linearisation, and is globalised by a backtracking line search on |F|.
+// The finite differences need Real = double to get much below the float tolerance, float stops
+// at the round-off floor as Multigrid does.
+template <typename Real>
+class NewtonKrylov {
+public:
+	NewtonKrylov(Rectangular<Real>& grid);
+
+	// Runs Newton steps until max |F| is below the tolerance, or the round-off floor of Real where
+	// that is larger, returns the steps used
+	int solve(int maxSteps);
+
+private:
+	Rectangular<Real>& grid;
+	Real dXi, dEta;
+	Multigrid<Real> fallback;	// FMG start and globalisation where the line search fails
+
+	// Krylov basis, the current residual, the Newton step and scratch for residual evaluations
+	vector<MeshPlanes<Real>> basis;
+	MeshPlanes<Real> residualPlanes, step;
+	MeshPlanes<Real> trial, trialResidual, boundaryPlanes, work, preconditioned;
+
+	// Frozen stencil coefficients (W/E, S/N, SE/NW) and, per boundary node, the rows inward a wall
+	// node copies x from (1 flat, 2 bump) and the wall slope its y follows
+	vector<Real> cW, cS, corner;
+	vector<int> wallStep;
+	vector<Real> wallSlope;
+
+	void residual(const MeshPlanes<Real>& u, MeshPlanes<Real>& F);
+	void freeze(const MeshPlanes<Real>& u);
+	void precondition(const MeshPlanes<Real>& r, MeshPlanes<Real>& e);
+	void jacobianTimes(const MeshPlanes<Real>& v, MeshPlanes<Real>& Jv);
+	int gmres(Real forcing, MeshPlanes<Real>& s);
+
+	Real dot(const MeshPlanes<Real>& a, const MeshPlanes<Real>& b) const;
+	Real maxNorm(const MeshPlanes<Real>& a) const;
+	void axpy(Real alpha, const MeshPlanes<Real>& a, MeshPlanes<Real>& b) const;
+};
+
+#endif // NEWTONKRYLOV_H
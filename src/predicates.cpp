@@ -0,0 +1,196 @@
+#include "predicates.h"
+#include <limits>
+
+namespace {
+
+// Half a unit in the last place of 1, the relative rounding error of every operation
+const double epsilon = std::numeric_limits<double>::epsilon() / 2;
+// 2^27 + 1, splits a double into two halves of 26 bits
+const double splitter = 134217729.0;
+
+const double orientErrorBound = (3.0 + 16.0 * epsilon) * epsilon;
+const double incircleErrorBound = (10.0 + 96.0 * epsilon) * epsilon;
+
+// x + y = a + b exactly, x the rounded sum
+inline void twoSum(double a, double b, double& x, double& y) {
+	x = a + b;
+	double bVirtual = x - a;
+	double aVirtual = x - bVirtual;
+	y = (a - aVirtual) + (b - bVirtual);
+}
+
+// The rounding error of x = a - b
+inline double differenceError(double a, double b, double x) {
+	double bVirtual = a - x;
+	double aVirtual = x + bVirtual;
+	return (a - aVirtual) + (bVirtual - b);
+}
+
+// As twoSum, for |a| >= |b|
+inline void fastTwoSum(double a, double b, double& x, double& y) {
+	x = a + b;
+	y = b - (x - a);
+}
+
+inline void split(double a, double& high, double& low) {
+	double c = splitter * a;
+	high = c - (c - a);
+	low = a - high;
+}
+
+// x + y = a * b exactly, x the rounded product
+inline void twoProduct(double a, double b, double& x, double& y) {
+	x = a * b;
+	double aHigh, aLow, bHigh, bLow;
+	split(a, aHigh, aLow);
+	split(b, bHigh, bLow);
+	double error = x - aHigh * bHigh - aLow * bHigh - aHigh * bLow;
+	y = aLow * bLow - error;
+}
+
+// An expansion is a sum of doubles that do not overlap, in increasing magnitude, so its sign is
+// that of the last one. The functions return the length of the result and drop zeros.
+
+// h = e + f, h has room for elength + flength
+int expansionSum(int elength, const double* e, int flength, const double* f, double* h) {
+	int ei = 0, fi = 0, hi = 0;
+	auto smaller = [&]() {
+		if (fi == flength || (ei < elength && std::fabs(e[ei]) < std::fabs(f[fi]))) return e[ei++];
+		return f[fi++];
+	};
+	double q = smaller();
+	while (ei < elength || fi < flength) {
+		double sum, error;
+		twoSum(q, smaller(), sum, error);
+		if (error != 0) h[hi++] = error;
+		q = sum;
+	}
+	if (q != 0 || hi == 0) h[hi++] = q;
+	return hi;
+}
+
+// h = b e, h has room for 2 elength
+int scaleExpansion(int elength, const double* e, double b, double* h) {
+	int hi = 0;
+	double q, error;
+	twoProduct(e[0], b, q, error);
+	if (error != 0) h[hi++] = error;
+	for (int ei = 1; ei < elength; ei++) {
+		double product, productError, sum;
+		twoProduct(e[ei], b, product, productError);
+		twoSum(q, productError, sum, error);
+		if (error != 0) h[hi++] = error;
+		fastTwoSum(product, sum, q, error);
+		if (error != 0) h[hi++] = error;
+	}
+	if (q != 0 || hi == 0) h[hi++] = q;
+	return hi;
+}
+
+// px qy - qx py, 4 components at most
+int minor(double px, double py, double qx, double qy, double* h) {
+	double plus[2], minus[2];
+	twoProduct(px, qy, plus[1], plus[0]);
+	twoProduct(-qx, py, minus[1], minus[0]);
+	return expansionSum(2, plus, 2, minus, h);
+}
+
+// orient2d as minor(a, b) + minor(b, c) + minor(c, a), 12 components at most
+int orientExpansion(const Node& a, const Node& b, const Node& c, double* h) {
+	double ab[4], bc[4], ca[4], abc[8];
+	int abLength = minor(a.x, a.y, b.x, b.y, ab);
+	int bcLength = minor(b.x, b.y, c.x, c.y, bc);
+	int caLength = minor(c.x, c.y, a.x, a.y, ca);
+	int abcLength = expansionSum(abLength, ab, bcLength, bc, abc);
+	return expansionSum(abcLength, abc, caLength, ca, h);
+}
+
+// sign (px^2 + py^2) o, 96 components at most
+int liftedExpansion(double px, double py, int olength, const double* o, double sign, double* h) {
+	double x[24], xx[48], y[24], yy[48];
+	int xLength = scaleExpansion(olength, o, px, x);
+	int xxLength = scaleExpansion(xLength, x, sign * px, xx);
+	int yLength = scaleExpansion(olength, o, py, y);
+	int yyLength = scaleExpansion(yLength, y, sign * py, yy);
+	return expansionSum(xxLength, xx, yyLength, yy, h);
+}
+
+double orientExact(const Node& a, const Node& b, const Node& c) {
+	double det[12];
+	int length = orientExpansion(a, b, c, det);
+	return det[length - 1];
+}
+
+// The 4 x 4 determinant of the rows (x, y, x^2 + y^2, 1), expanded along the lifted column
+double incircleExact(const Node& a, const Node& b, const Node& c, const Node& d) {
+	double bcd[12], acd[12], abd[12], abc[12];
+	int bcdLength = orientExpansion(b, c, d, bcd);
+	int acdLength = orientExpansion(a, c, d, acd);
+	int abdLength = orientExpansion(a, b, d, abd);
+	int abcLength = orientExpansion(a, b, c, abc);
+
+	double aTerm[96], bTerm[96], cTerm[96], dTerm[96], abTerms[192], cdTerms[192], det[384];
+	int aLength = liftedExpansion(a.x, a.y, bcdLength, bcd, 1, aTerm);
+	int bLength = liftedExpansion(b.x, b.y, acdLength, acd, -1, bTerm);
+	int cLength = liftedExpansion(c.x, c.y, abdLength, abd, 1, cTerm);
+	int dLength = liftedExpansion(d.x, d.y, abcLength, abc, -1, dTerm);
+	int abLength = expansionSum(aLength, aTerm, bLength, bTerm, abTerms);
+	int cdLength = expansionSum(cLength, cTerm, dLength, dTerm, cdTerms);
+	int length = expansionSum(abLength, abTerms, cdLength, cdTerms, det);
+	return det[length - 1];
+}
+
+// The 3 x 3 determinant of the rows (x, y, x^2 + y^2) relative to d, when the differences are exact
+double incircleFromDifferences(double adx, double ady, double bdx, double bdy, double cdx, double cdy) {
+	double bc[4], ca[4], ab[4];
+	int bcLength = minor(bdx, bdy, cdx, cdy, bc);
+	int caLength = minor(cdx, cdy, adx, ady, ca);
+	int abLength = minor(adx, ady, bdx, bdy, ab);
+
+	double aTerm[32], bTerm[32], cTerm[32], abTerms[64], det[96];
+	int aLength = liftedExpansion(adx, ady, bcLength, bc, 1, aTerm);
+	int bLength = liftedExpansion(bdx, bdy, caLength, ca, 1, bTerm);
+	int cLength = liftedExpansion(cdx, cdy, abLength, ab, 1, cTerm);
+	int abTermsLength = expansionSum(aLength, aTerm, bLength, bTerm, abTerms);
+	int length = expansionSum(abTermsLength, abTerms, cLength, cTerm, det);
+	return det[length - 1];
+}
+
+}
+
+double orient2d(const Node& a, const Node& b, const Node& c) {
+	double detLeft = (double(a.x) - c.x) * (double(b.y) - c.y);
+	double detRight = (double(a.y) - c.y) * (double(b.x) - c.x);
+	double det = detLeft - detRight;
+	double bound = orientErrorBound * (std::fabs(detLeft) + std::fabs(detRight));
+	if (det > bound || -det > bound) return det;
+	return orientExact(a, b, c);
+}
+
+double incircle(const Node& a, const Node& b, const Node& c, const Node& d) {
+	double adx = double(a.x) - d.x, ady = double(a.y) - d.y;
+	double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y;
+	double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y;
+
+	double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+	double cdxady = cdx * ady, adxcdy = adx * cdy;
+	double adxbdy = adx * bdy, bdxady = bdx * ady;
+	double aLift = adx * adx + ady * ady;
+	double bLift = bdx * bdx + bdy * bdy;
+	double cLift = cdx * cdx + cdy * cdy;
+
+	double det = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+	double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * aLift
+		+ (std::fabs(cdxady) + std::fabs(adxcdy)) * bLift
+		+ (std::fabs(adxbdy) + std::fabs(bdxady)) * cLift;
+	double bound = incircleErrorBound * permanent;
+	if (det > bound || -det > bound) return det;
+
+	// Float coordinates almost always differ exactly in double, which saves lifting the 4 x 4 form
+	if (differenceError(a.x, d.x, adx) == 0 && differenceError(a.y, d.y, ady) == 0
+		&& differenceError(b.x, d.x, bdx) == 0 && differenceError(b.y, d.y, bdy) == 0
+		&& differenceError(c.x, d.x, cdx) == 0 && differenceError(c.y, d.y, cdy) == 0) {
+		return incircleFromDifferences(adx, ady, bdx, bdy, cdx, cdy);
+	}
+	return incircleExact(a, b, c, d);
+}
@@ -0,0 +1,19 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include "geometry.h"
+
+// Geometric predicates with exact signs (Shewchuk). Each is evaluated in double first and the
+// result kept when it is further from 0 than the rounding error bound; only nearly degenerate
+// inputs are evaluated again in exact expansion arithmetic. The values are approximate, the
+// signs exact. predicates.cpp must not be built with -ffast-math, which breaks the exact sums.
+
+// Positive when a, b, c run counterclockwise, negative when clockwise, 0 when collinear.
+// About twice the area of the triangle.
+double orient2d(const Node& a, const Node& b, const Node& c);
+
+// Positive when d lies inside the circle through a, b, c, which run counterclockwise, negative
+// outside, 0 on it
+double incircle(const Node& a, const Node& b, const Node& c, const Node& d);
+
+#endif // PREDICATES_H
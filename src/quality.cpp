@@ -0,0 +1,142 @@
+#include "quality.h"
+#include <algorithm>
+
+namespace {
+
+// Running worst values as squares, cos^2 and sin * |sin| of the corner angles, so the cell loop
+// needs no square roots
+template <typename Real>
+struct QualityPartial {
+	Real maxCosSq = 0;
+	Real maxAspectSq = 1;
+	Real minJacobianSq = 1;
+	int inverted = 0;
+
+	void merge(const QualityPartial& o) {
+		maxCosSq = max(maxCosSq, o.maxCosSq);
+		maxAspectSq = max(maxAspectSq, o.maxAspectSq);
+		minJacobianSq = min(minJacobianSq, o.minJacobianSq);
+		inverted += o.inverted;
+	}
+};
+
+// Per-cell values of one row of cells between the rows of nodes x0/y0 and x1/y1. There is no
+// reduction in the loop, which the compiler may not vectorise for floats without fast-math, and
+// the outputs are restrict, so it vectorises over i as it is.
+template <typename Real>
+void cellRow(const Real* __restrict x0, const Real* __restrict y0, const Real* __restrict x1, const Real* __restrict y1, int cells,
+	Real* __restrict cosSq, Real* __restrict aspectSq, Real* __restrict jacobianSq, int* __restrict folded) {
+	for (int i = 0; i < cells; i++) {
+		// Edges south, east, north, west, counter-clockwise
+		Real sx = x0[i + 1] - x0[i], sy = y0[i + 1] - y0[i];
+		Real ex = x1[i + 1] - x0[i + 1], ey = y1[i + 1] - y0[i + 1];
+		Real nx = x1[i] - x1[i + 1], ny = y1[i] - y1[i + 1];
+		Real wx = x0[i] - x1[i], wy = y0[i] - y1[i];
+		Real s2 = sx * sx + sy * sy, e2 = ex * ex + ey * ey, n2 = nx * nx + ny * ny, w2 = wx * wx + wy * wy;
+
+		// Corners between an incoming and an outgoing edge: cos^2, sin * |sin|, folded
+		Real maxCos = 0, minJacobian = 1;
+		int fold = 0;
+		auto corner = [&](Real ax, Real ay, Real a2, Real bx, Real by, Real b2) {
+			Real cross = ax * by - ay * bx;
+			Real dot = ax * bx + ay * by;
+			Real scale = Real(1) / (a2 * b2);
+			maxCos = max(maxCos, dot * dot * scale);
+			minJacobian = min(minJacobian, cross * std::fabs(cross) * scale);
+			fold |= cross <= Real(0);
+		};
+		corner(wx, wy, w2, sx, sy, s2);
+		corner(sx, sy, s2, ex, ey, e2);
+		corner(ex, ey, e2, nx, ny, n2);
+		corner(nx, ny, n2, wx, wy, w2);
+
+		cosSq[i] = maxCos;
+		aspectSq[i] = max(max(s2, e2), max(n2, w2)) / min(min(s2, e2), min(n2, w2));
+		jacobianSq[i] = minJacobian;
+		folded[i] = fold;
+	}
+}
+
+// Cells of rows [jBegin, jEnd), evaluated row by row into scratch and then reduced
+template <typename Real>
+QualityPartial<Real> cellRows(const MeshPlanes<Real>& planes, int jBegin, int jEnd) {
+	const int cells = planes.iMax - 1;
+	vector<Real> cosSq(cells), aspectSq(cells), jacobianSq(cells);
+	vector<int> folded(cells);
+	QualityPartial<Real> worst;
+
+	for (int j = jBegin; j < jEnd; j++) {
+		int k0 = planes.index(0, j), k1 = planes.index(0, j + 1);
+		cellRow(planes.x() + k0, planes.y() + k0, planes.x() + k1, planes.y() + k1, cells,
+			cosSq.data(), aspectSq.data(), jacobianSq.data(), folded.data());
+
+		for (int i = 0; i < cells; i++) {
+			worst.maxCosSq = max(worst.maxCosSq, cosSq[i]);
+			worst.maxAspectSq = max(worst.maxAspectSq, aspectSq[i]);
+			worst.minJacobianSq = min(worst.minJacobianSq, jacobianSq[i]);
+			worst.inverted += folded[i];
+		}
+	}
+	return worst;
+}
+
+// sin of the angle between the first grid line off the wall in row j and the wall normal. At a
+// kink, such as where a bump starts, any line between the normals of the two wall segments
+// counts as orthogonal.
+template <typename Real>
+Real wallDeviation(const MeshPlanes<Real>& planes, int j, int inward) {
+	const Real* X = planes.x();
+	const Real* Y = planes.y();
+	Real worst = 0;
+	for (int i = 1; i < planes.iMax - 1; i++) {
+		int k = planes.index(i, j);
+		Real lx = X[k + inward] - X[k], ly = Y[k + inward] - Y[k];
+		Real bx = X[k] - X[k - 1], by = Y[k] - Y[k - 1];
+		Real fx = X[k + 1] - X[k], fy = Y[k + 1] - Y[k];
+		Real lengthSq = lx * lx + ly * ly;
+		Real backward = (bx * lx + by * ly) / std::sqrt((bx * bx + by * by) * lengthSq);
+		Real forward = (fx * lx + fy * ly) / std::sqrt((fx * fx + fy * fy) * lengthSq);
+		Real sine = backward * forward <= 0 ? Real(0) : min(std::fabs(backward), std::fabs(forward));
+		worst = max(worst, sine);
+	}
+	return worst;
+}
+
+}
+
+bool meetsTargets(const MeshQuality& quality, const QualityTargets& targets) {
+	return quality.invertedCells == 0 && quality.maxSkewness <= targets.maxSkewness
+		&& quality.maxAspectRatio <= targets.maxAspectRatio && quality.maxWallDeviation <= targets.maxWallDeviation;
+}
+
+template <typename Real>
+MeshQuality meshQuality(const MeshPlanes<Real>& planes, ThreadPool* pool) {
+	const double halfPi = 1.57079632679489661923;
+	int cellRowCount = planes.jMax - 1;
+
+	QualityPartial<Real> worst;
+	if (pool && pool->size() > 1) {
+		vector<QualityPartial<Real>> partials(pool->size());
+		pool->parallelFor(0, cellRowCount, [&](int begin, int end, int thread) {
+			partials[thread] = cellRows(planes, begin, end);
+		});
+		for (const auto& partial : partials) worst.merge(partial);
+	}
+	else {
+		worst = cellRows(planes, 0, cellRowCount);
+	}
+
+	Real wall = max(wallDeviation(planes, 0, planes.stride), wallDeviation(planes, planes.jMax - 1, -planes.stride));
+
+	MeshQuality quality;
+	double jacobianSq = worst.minJacobianSq;
+	quality.maxSkewness = std::asin(std::min(std::sqrt(double(worst.maxCosSq)), 1.0)) / halfPi;
+	quality.maxAspectRatio = std::sqrt(double(worst.maxAspectSq));
+	quality.maxWallDeviation = std::asin(std::min(double(wall), 1.0)) * 90.0 / halfPi;
+	quality.minJacobian = jacobianSq < 0 ? -std::sqrt(-jacobianSq) : std::sqrt(jacobianSq);
+	quality.invertedCells = worst.inverted;
+	return quality;
+}
+
+template MeshQuality meshQuality<float>(const MeshPlanes<float>&, ThreadPool*);
+template MeshQuality meshQuality<double>(const MeshPlanes<double>&, ThreadPool*);
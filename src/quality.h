@@ -0,0 +1,31 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include "geometry.h"
+#include "meshplanes.h"
+#include "threadpool.h"
+
+// Worst-cell quality of a structured grid
+struct MeshQuality {
+	double maxSkewness = 0;			// equiangle skewness, 0 when every corner is 90 degrees, 1 when one is 0 or 180
+	double maxAspectRatio = 1;		// longest over shortest edge of a cell
+	double maxWallDeviation = 0;	// degrees between the grid lines leaving the south / north wall and its normal
+	double minJacobian = 1;			// scaled Jacobian, the sine of the smallest corner angle, <= 0 when folded
+	int invertedCells = 0;			// cells with a corner of non-positive Jacobian
+};
+
+// Limits a grid has to meet, in the units of MeshQuality. A grid with inverted cells never does.
+struct QualityTargets {
+	double maxSkewness = 0.5;
+	double maxAspectRatio = 50;
+	double maxWallDeviation = 5;
+};
+
+bool meetsTargets(const MeshQuality& quality, const QualityTargets& targets);
+
+// Evaluates every cell of the planes, rows of cells split over the pool when one is given.
+// Cells are taken counter-clockwise from their south-west corner, as in structuredRectangles.
+template <typename Real>
+MeshQuality meshQuality(const MeshPlanes<Real>& planes, ThreadPool* pool = nullptr);
+
+#endif // QUALITY_H
@@ -1,46 +1,257 @@
 #include "rectangular.h"
+#include "stencil.h"
+#include "multigrid.h"
+#include "newtonkrylov.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
 
-void Rectangular::createPoints() {
+template <typename Real>
+void Rectangular<Real>::createPoints() {
+	mesh = MeshPlanes<Real>(iMax, jMax);
 	for (int i = 0; i < N; i++) {
-		points.push_back({ static_cast<float>(i % iMax), static_cast<float>(i / iMax) });
+		mesh.setNode(at(i), { static_cast<Real>(i % iMax), static_cast<Real>(i / iMax) });
 	}
 }
 
-void Rectangular::clusterPoints() {
+template <typename Real>
+void Rectangular<Real>::createClustering() {
+	if (int(xiNodes.size()) != iMax) xiNodes = clusterNodes(settings.xiClustering, iMax);
+	etaNodes = clusterNodes(settings.etaClustering, jMax);
+
+	stretchXi.clear();
+	stretchEta.clear();
+	southRise = northRise = 0;
+	bool uniform = settings.xiClustering.stretching == Stretching::Uniform && settings.etaClustering.stretching == Stretching::Uniform;
+	if (!settings.controlFunctions || uniform) return;
+
+	for (double factor : stretchFactors(xiNodes)) stretchXi.push_back(Real(factor));
+	for (double factor : stretchFactors(etaNodes)) stretchEta.push_back(Real(factor));
+	if (settings.etaClustering.stretching != Stretching::Uniform && jMax >= 3) {
+		southRise = etaNodes[2] - etaNodes[0];
+		northRise = etaNodes[jMax - 1] - etaNodes[jMax - 3];
+	}
+}
+
+template <typename Real>
+void Rectangular<Real>::clusterPoints() {
+	for (int i = 0; i < N; i++) {
+		mesh.setNode(at(i), { Real(xiNodes[i % iMax]), Real(etaNodes[i / iMax]) });
+	}
+}
+
+WallShape sineBump(double base, double height, double xBegin, double xEnd) {
+	WallShape shape;
+	shape.xBegin = xBegin;
+	shape.xEnd = xEnd;
+	shape.y = [=](double x) {
+		if (x >= xBegin && x <= xEnd) {
+			return base + height * sin((x - xBegin) * M_PI / (xEnd - xBegin));
+		}
+		else {
+			return base;
+		}
+	};
+	shape.slope = [=](double x) {
+		return height * M_PI / (xEnd - xBegin) * cos((x - xBegin) * M_PI / (xEnd - xBegin));
+	};
+	return shape;
+}
+
+Channel bumpChannel(double height) {
+	Channel channel;
+	channel.south = sineBump(0.0, height, 2.0, 3.0);
+	channel.north = sineBump(1.0, -height, 2.0, 3.0);
+	return channel;
+}
+
+template <typename Real>
+void Rectangular<Real>::createBoundary() {
+	// Boundary nodes in row-major order, which is the order the conditions are applied in.
+	// Side nodes with i % jMax == 0 or jMax - 1 are left alone, as they always have been.
+	// Interface columns belong to the neighbour block and get no conditions at all.
+	boundary.clear();
 	for (int i = 0; i < N; i++) {
-		float xi = points[i].x / (iMax - 1);
-		float eta = points[i].y / (jMax - 1);
-		points[i] = { xi, eta };
+		int row = i / iMax, column = i % iMax;
+		if ((column == 0 && westInterface) || (column == iMax - 1 && eastInterface)) continue;
+		BoundaryNode node = { at(i), 0, 0 };
+		if (row == 0) node.wall = 1;
+		else if (row == jMax - 1) node.wall = -1;
+		if (i % jMax != 0 && i % jMax != jMax - 1) {
+			if (column == 0) node.side = 1;
+			else if (column == iMax - 1) node.side = -1;
+		}
+		if (node.wall != 0 || node.side != 0) boundary.push_back(node);
+		if (row == 0) southEnd = boundary.size();
+		if (row < jMax - 1) northBegin = boundary.size();
 	}
 }
 
-float Rectangular::y_S(float x) {
-	if (x >= 2.0 && x <= 3.0) {
-		return float(0.1 * sin((x - 2.0) * M_PI));
+template <typename Real>
+void Rectangular<Real>::transformXY(Real x_W, Real x_E) {
+	for (int i = 0; i < N; i++) {
+		BasicNode<Real> p = mesh.node(at(i));
+		Real x = x_W + p.x * (x_E - x_W);
+		Real y = Real(south.y(x)) + p.y * (Real(north.y(x)) - Real(south.y(x)));
+		mesh.setNode(at(i), { x,y });
+	}
+}
+
+template <typename Real>
+void Rectangular<Real>::interpolateTFI(Real x_W, Real x_E, bool orthogonal) {
+	// Boolean sum of an interpolation across the channel, between the south and north walls, and
+	// a linear one between the west and east sides. When orthogonal, the first is cubic Hermite
+	// with dP/deta along the wall normals, scaled by the local channel height, which puts the
+	// nodes near the walls close to where the orthogonality condition of enforceBCs pulls them.
+	auto across = [&](double x, double eta) {
+		BasicNode<double> S = { x, south.y(x) };
+		BasicNode<double> P = { x, north.y(x) };
+		if (!orthogonal) {
+			return BasicNode<double>{ S.x + eta * (P.x - S.x), S.y + eta * (P.y - S.y) };
+		}
+
+		double height = P.y - S.y;
+		double slopeS = south.slope(x), slopeN = north.slope(x);
+		BasicNode<double> TS = { -slopeS * height / sqrt(1 + slopeS * slopeS), height / sqrt(1 + slopeS * slopeS) };
+		BasicNode<double> TN = { -slopeN * height / sqrt(1 + slopeN * slopeN), height / sqrt(1 + slopeN * slopeN) };
+		if (x < south.xBegin || x > south.xEnd) TS = { 0.0, height };
+		if (x < north.xBegin || x > north.xEnd) TN = { 0.0, height };
+
+		double h0 = 2 * eta * eta * eta - 3 * eta * eta + 1;
+		double h1 = -2 * eta * eta * eta + 3 * eta * eta;
+		double h2 = eta * eta * eta - 2 * eta * eta + eta;
+		double h3 = eta * eta * eta - eta * eta;
+		return BasicNode<double>{ h0 * S.x + h1 * P.x + h2 * TS.x + h3 * TN.x, h0 * S.y + h1 * P.y + h2 * TS.y + h3 * TN.y };
+	};
+	auto side = [&](double x, double eta) {
+		return BasicNode<double>{ x, south.y(x) + eta * (north.y(x) - south.y(x)) };
+	};
+
+	for (int j = 0; j < jMax; j++) {
+		double eta = etaNodes[j];
+		BasicNode<double> westError = side(x_W, eta) - across(x_W, eta);
+		BasicNode<double> eastError = side(x_E, eta) - across(x_E, eta);
+
+		for (int i = 0; i < iMax; i++) {
+			double xi = xiNodes[i];
+			BasicNode<double> p = across(x_W + xi * (x_E - x_W), eta);
+			p.x += (1 - xi) * westError.x + xi * eastError.x;
+			p.y += (1 - xi) * westError.y + xi * eastError.y;
+			mesh.setNode(mesh.index(i, j), { Real(p.x), Real(p.y) });
+		}
+	}
+}
+
+template <typename Real>
+void Rectangular<Real>::initialGuess() {
+	if (settings.initialGuess == InitialGuess::Shear) {
+		clusterPoints();
+		transformXY(Real(x_W), Real(x_E));
 	}
 	else {
-		return 0.f;
+		interpolateTFI(Real(x_W), Real(x_E), settings.initialGuess == InitialGuess::HermiteTFI);
+	}
+}
+
+template <typename Real>
+void Rectangular<Real>::warmStart(const GridPoints<Real>& start) {
+	// Bilinear interpolation of start in index space, then a map from its channel onto this one:
+	// x is stretched between the sides, y keeps its fraction of the channel height. start's walls
+	// are taken as the polylines through its south and north rows.
+	int I = start.iMax, J = start.jMax;
+	if (I < 2 || J < 2 || int(start.points.size()) != I * J) {
+		throw std::invalid_argument("Warm start needs the points of a grid with at least 2 x 2 nodes");
+	}
+	const vector<BasicNode<Real>>& P = start.points;
+	double startW = P[0].x, startE = P[I - 1].x;
+
+	auto wallY = [&](int row, double x) {
+		const BasicNode<Real>* wall = &P[row * I];
+		int m = int(std::upper_bound(wall, wall + I, x, [](double value, const BasicNode<Real>& p) { return value < p.x; }) - wall);
+		m = std::clamp(m, 1, I - 1);
+		double t = (x - wall[m - 1].x) / (wall[m].x - wall[m - 1].x);
+		return wall[m - 1].y + t * (wall[m].y - wall[m - 1].y);
+	};
+
+	for (int j = 0; j < jMax; j++) {
+		double v = double(j) * (J - 1) / (jMax - 1);
+		int j0 = std::min(int(v), J - 2);
+		double fy = v - j0;
+
+		for (int i = 0; i < iMax; i++) {
+			double u = double(i) * (I - 1) / (iMax - 1);
+			int i0 = std::min(int(u), I - 2);
+			double fx = u - i0;
+
+			const BasicNode<Real>& a = P[j0 * I + i0];
+			const BasicNode<Real>& b = P[j0 * I + i0 + 1];
+			const BasicNode<Real>& c = P[(j0 + 1) * I + i0];
+			const BasicNode<Real>& d = P[(j0 + 1) * I + i0 + 1];
+			double x = (1 - fy) * ((1 - fx) * a.x + fx * b.x) + fy * ((1 - fx) * c.x + fx * d.x);
+			double y = (1 - fy) * ((1 - fx) * a.y + fx * b.y) + fy * ((1 - fx) * c.y + fx * d.y);
+
+			double ySouth = wallY(0, x), yNorth = wallY(J - 1, x);
+			double fraction = (y - ySouth) / (yNorth - ySouth);
+			double newX = x_W + (x - startW) / (startE - startW) * (x_E - x_W);
+			double newY = south.y(newX) + fraction * (north.y(newX) - south.y(newX));
+			mesh.setNode(mesh.index(i, j), { Real(newX), Real(newY) });
+		}
 	}
 }
 
-float Rectangular::y_N(float x) {
-	if (x >= 2.0 && x <= 3.0) {
-		return float(1 - 0.1 * sin((x - 2) * M_PI));
+template <typename Real>
+void Rectangular<Real>::solve() {
+	if (settings.solver != Solver::GaussSeidel && settings.checkpointSeconds > 0) {
+		throw std::invalid_argument("Checkpoints are Gauss-Seidel only");
+	}
+	if (settings.solver == Solver::Multigrid) {
+		multigrid(settings.maxCycles);
+	}
+	else if (settings.solver == Solver::NewtonKrylov) {
+		newtonKrylov(settings.maxNewtonSteps);
 	}
 	else {
-		return 1.f;
+		gaussSeibel(15000);
 	}
 }
 
-void Rectangular::transformXY(float x_W, float x_E) {
-	for (int i = 0; i < points.size(); i++) {
-		float x = x_W + points[i].x * (x_E - x_W);
-		float y = y_S(x) + points[i].y * (y_N(x) - y_S(x));
-		points[i] = { x,y };
+template <typename Real>
+GridPoints<Real> Rectangular<Real>::readPointsTecplot(const std::string& filename) {
+	// Reads back the single POINT zone written by writePointsTecplot
+	std::ifstream inFile(filename);
+	if (!inFile) {
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	GridPoints<Real> grid;
+	std::string line;
+	while (std::getline(inFile, line)) {
+		if (line.rfind("ZONE", 0) != 0) continue;
+		std::size_t i = line.find("I="), j = line.find("J=");
+		if (i == std::string::npos || j == std::string::npos) break;
+		grid.iMax = std::stoi(line.substr(i + 2));
+		grid.jMax = std::stoi(line.substr(j + 2));
+		break;
+	}
+	if (grid.iMax < 2 || grid.jMax < 2) {
+		throw std::runtime_error("No I x J zone in file: " + filename);
+	}
+
+	grid.points.resize(std::size_t(grid.iMax) * grid.jMax);
+	for (BasicNode<Real>& point : grid.points) {
+		double x, y;
+		if (!(inFile >> x >> y)) {
+			throw std::runtime_error("Too few points in file: " + filename);
+		}
+		point = { Real(x), Real(y) };
 	}
+	return grid;
 }
 
-void Rectangular::writePointsTecplot(const std::string& filename) {
+static std::ofstream openTecplot(const std::string& filename) {
 	std::ofstream outFile(filename);
 	if (!outFile) {
 		throw std::runtime_error("Failed to open file: " + filename);
@@ -48,179 +259,724 @@ void Rectangular::writePointsTecplot(const std::string& filename) {
 
 	outFile << "TITLE = \"2D Mesh Data\"\n";
 	outFile << "VARIABLES = \"X\" \"Y\"\n";
-	outFile << "ZONE T=\"2D Mesh\", I=" << iMax << ", J=" << jMax << ", DATAPACKING=POINT\n";
+	return outFile;
+}
+
+template <typename Real>
+static void writeTecplotZone(std::ofstream& outFile, const std::string& title, const GridPoints<Real>& grid) {
+	outFile << "ZONE T=\"" << title << "\", I=" << grid.iMax << ", J=" << grid.jMax << ", DATAPACKING=POINT\n";
 
-	for (const auto point : points) {
+	for (const auto point : grid.points) {
 		outFile << point.x << " " << point.y << "\n";
 	}
+}
 
+template <typename Real>
+void writeGridTecplot(const std::string& filename, const GridPoints<Real>& grid) {
+	std::ofstream outFile = openTecplot(filename);
+	writeTecplotZone(outFile, "2D Mesh", grid);
 	outFile.close();
 }
 
-void Rectangular::enforceBCs(float dXi, float dEta) {
-	for (int i = 0; i < N; i++) {
-		if (i / iMax == 0 || i / iMax == jMax - 1) {
-			if (points[i].x < 2.0 || points[i].x > 3.0) {
-				if (i + iMax < N) {
-					points[i].x = points[i + iMax].x;
-				}
-				else {
-					points[i].x = points[i - iMax].x;
-				}
-			}
+template <typename Real>
+void writeGridTecplot(const std::string& filename, const vector<GridPoints<Real>>& zones, const std::string& zoneTitle) {
+	std::ofstream outFile = openTecplot(filename);
+	for (std::size_t z = 0; z < zones.size(); z++) {
+		writeTecplotZone(outFile, zoneTitle + " " + std::to_string(z), zones[z]);
+	}
+	outFile.close();
+}
 
-			if ((points[i].x < 3.0 && points[i].x > 2.0) || points[i].x == 2.0 || points[i].x == 3.0) {
-				if (i + 2 * iMax < N) {
-					points[i].x = float(points[i + 2 * iMax].x + 2 * (0.1 * M_PI * cos((points[i].x - 2) * M_PI)) * dEta);
-					points[i].y = y_S(points[i].x);
-				}
-				else {
-					points[i].x = float(points[i - 2 * iMax].x + 2 * (0.1 * M_PI * cos((points[i].x - 2) * M_PI)) * dEta);
-					points[i].y = y_N(points[i].x);
-				}
-			}
-		}
-		if (i % iMax == 0 || i % iMax == iMax - 1) {
-			if (i % jMax != 0 && i % jMax != jMax - 1) {
-				if (i % iMax == 0) {
-					points[i].y = points[i + 1].y;
-				}
-				else if (i % iMax == iMax - 1) {
-					points[i].y = points[i - 1].y;
-				}
-			}
-		}
+template void writeGridTecplot(const std::string& filename, const GridPoints<float>& grid);
+template void writeGridTecplot(const std::string& filename, const GridPoints<double>& grid);
+template void writeGridTecplot(const std::string& filename, const vector<GridPoints<float>>& zones, const std::string& zoneTitle);
+template void writeGridTecplot(const std::string& filename, const vector<GridPoints<double>>& zones, const std::string& zoneTitle);
+
+template <typename Real>
+void Rectangular<Real>::writePointsTecplot(const std::string& filename) {
+	writeGridTecplot(filename, getGridPoints());
+}
+
+template <typename Real>
+void Rectangular<Real>::enforceBCs(MeshPlanes<Real>& planes, Real dEta) {
+	// Same row-major order as the boundary list, one loop per kind of node
+	enforceWall<1>(planes, 0, southEnd, dEta);
+
+	Real* Y = planes.y();
+	for (std::size_t n = southEnd; n < northBegin; n++) {
+		Y[boundary[n].k] = Y[boundary[n].k + boundary[n].side];
 	}
 
-	int BLE = 0, BTE = 0, TLE = 0, TTE = 0;
-	for (int i = 0; i < N; i++) {
-		int ir = N - i - 1;
-		if (i / iMax == 0 && i % iMax != 0 && i % iMax != iMax - 1) {
-			if (2 - points[i].x > 0) BLE = i;
-			if (3 - points[ir].x < 0) BTE = ir;
+	enforceWall<-1>(planes, northBegin, boundary.size(), dEta);
+
+	snapEdges(planes, 0, south);
+	snapEdges(planes, jMax - 1, north);
+}
+
+template <typename Real>
+template <int Wall>
+void Rectangular<Real>::enforceWall(MeshPlanes<Real>& planes, std::size_t first, std::size_t last, Real dEta) {
+	Real* X = planes.x();
+	Real* Y = planes.y();
+	const WallShape& shape = Wall == 1 ? south : north;
+	const int inward = Wall * planes.stride;
+	double rise = Wall == 1 ? southRise : northRise;
+	if (rise == 0) rise = 2 * dEta;
+
+	for (std::size_t n = first; n < last; n++) {
+		int k = boundary[n].k;
+		if (X[k] < shape.xBegin || X[k] > shape.xEnd) {
+			X[k] = X[k + inward];
+		}
+
+		if (X[k] >= shape.xBegin && X[k] <= shape.xEnd) {
+			X[k] = Real(X[k + 2 * inward] + Wall * shape.slope(X[k]) * rise);
+			Y[k] = Real(shape.y(X[k]));
 		}
-		if (i / iMax == jMax - 1 && i % iMax != 0 && i % iMax != iMax - 1) {
-			if (2 - points[i].x > 0) TLE = i;
-			if (3 - points[ir].x < 0) TTE = ir;
+		// Only corners, the rest of a wall row has no side condition
+		if (boundary[n].side != 0) {
+			Y[k] = Y[k + boundary[n].side];
 		}
 	}
-	points[BLE].x = 2;
-	points[BLE].y = 0;
+}
 
-	points[BTE].x = 3;
-	points[BTE].y = 1;
+template <typename Real>
+void Rectangular<Real>::snapEdges(MeshPlanes<Real>& planes, int j, const WallShape& shape) {
+	// Pins the last wall node before the bump to its start and the first one after it to its end.
+	// Judged against the corner or halo neighbour too, so in a MultiBlock only one block pins.
+	Real* X = planes.x();
+	Real* Y = planes.y();
+	int leading = -1, trailing = -1;
 
-	points[TLE].x = 2;
-	points[TLE].y = 1;
+	for (int i = 1; i < iMax - 1; i++) {
+		int k = planes.index(i, j);
+		if (X[k] < shape.xBegin && X[k + 1] >= shape.xBegin) leading = k;
+		if (X[k] > shape.xEnd && X[k - 1] <= shape.xEnd && trailing < 0) trailing = k;
+	}
 
-	points[TTE].x = 3;
-	points[TTE].y = 0;
+	if (leading >= 0) {
+		X[leading] = Real(shape.xBegin);
+		Y[leading] = Real(shape.y(shape.xBegin));
+	}
+	if (trailing >= 0) {
+		X[trailing] = Real(shape.xEnd);
+		Y[trailing] = Real(shape.y(shape.xEnd));
+	}
 }
 
-Node Rectangular::dx(int i, float dXi, float dEta) {
-	float newdXi = (points[i + 1].x - points[i - 1].x)/(2 * dXi);
-	float newdEta = (points[i + iMax].x - points[i - iMax].x) / (2 * dEta);
+template <typename Real>
+BasicNode<Real> Rectangular<Real>::dx(int k, Real dXi, Real dEta) {
+	const Real* X = mesh.x();
+	Real newdXi = (X[k + 1] - X[k - 1])/(2 * dXi);
+	Real newdEta = (X[k + mesh.stride] - X[k - mesh.stride]) / (2 * dEta);
 
 	return { newdXi, newdEta };
 }
 
-Node Rectangular::dy(int i, float dXi, float dEta) {
-	float newdXi = (points[i + 1].y - points[i - 1].y) / (2 * dXi);
-	float newdEta = (points[i + iMax].y - points[i - iMax].y) / (2 * dEta);
+template <typename Real>
+BasicNode<Real> Rectangular<Real>::dy(int k, Real dXi, Real dEta) {
+	const Real* Y = mesh.y();
+	Real newdXi = (Y[k + 1] - Y[k - 1]) / (2 * dXi);
+	Real newdEta = (Y[k + mesh.stride] - Y[k - mesh.stride]) / (2 * dEta);
 
 	return { newdXi, newdEta };
 }
 
-float Rectangular::alpha(int i, float dXi, float dEta) {
-	Node dX = dx(i, dXi, dEta);
-	Node dY = dy(i, dXi, dEta);
+template <typename Real>
+void Rectangular<Real>::enforceICs(Real dXi, Real dEta, Real& maxChange) {
+	// The control functions are chosen once per sweep rather than per node
+	if (stretchXi.empty()) maxChange = max(maxChange, relaxInterior<false>(dXi, dEta));
+	else maxChange = max(maxChange, relaxInterior<true>(dXi, dEta));
+}
+
+template <typename Real>
+template <bool Stretched>
+Real Rectangular<Real>::relaxInterior(Real dXi, Real dEta) {
+	Real* X = mesh.x();
+	Real* Y = mesh.y();
+	const int stride = mesh.stride;
+	Real maxChange = 0;
 
-	return float(pow(dX.y, 2) + pow(dY.y, 2));
+	for (int j = 1; j < jMax - 1; j++) {
+		const int row = mesh.index(0, j);
+		for (int i = 1; i < iMax - 1; i++) {
+			Real change;
+			if constexpr (Stretched) change = relaxWinslowNode(X, Y, row + i, stride, dXi, dEta, stretchXi[i], stretchEta[j]);
+			else change = relaxWinslowNode(X, Y, row + i, stride, dXi, dEta);
+			maxChange = max(maxChange, change);
+		}
+	}
+	return maxChange;
 }
 
-float Rectangular::beta(int i, float dXi, float dEta) {
-	Node dX = dx(i, dXi, dEta);
-	Node dY = dy(i, dXi, dEta);
-	return -(dX.x * dX.y + dY.x * dY.y);
+template <typename Real>
+void Rectangular<Real>::enforceICsRedBlack(Real dXi, Real dEta, Real& maxChange, ThreadPool& pool) {
+	// The cross-derivative term couples diagonal neighbours, so plain red-black is not enough:
+	// colouring by (i, j) parity leaves no two nodes of one colour in the same 9-point stencil.
+	static const ColourRowKernel<Real> relaxRow = colourRowKernel<Real>(detectSimdLevel());
+	vector<Real> threadMax(pool.size(), Real(0));
+
+	for (int colour = 0; colour < 4; colour++) {
+		int iStart = 1 + colour % 2;
+		int jStart = 1 + colour / 2;
+		int rows = (jMax - jStart) / 2;
+
+		pool.parallelFor(0, rows, [&](int rowBegin, int rowEnd, int thread) {
+			Real localMax = threadMax[thread];
+			for (int row = rowBegin; row < rowEnd; row++) {
+				int j = jStart + 2 * row;
+				if (stretchXi.empty()) {
+					localMax = max(localMax, relaxRow(mesh.x(), mesh.y(), mesh.index(iStart, j), (iMax - iStart) / 2, mesh.stride, dXi, dEta));
+				}
+				else {
+					localMax = max(localMax, relaxRowStretched(iStart, j, (iMax - iStart) / 2, dXi, dEta));
+				}
+			}
+			threadMax[thread] = localMax;
+		});
+	}
+
+	for (Real change : threadMax) {
+		maxChange = max(maxChange, change);
+	}
 }
 
-float Rectangular::gamma(int i, float dXi, float dEta) {
-	Node dX = dx(i, dXi, dEta);
-	Node dY = dy(i, dXi, dEta);
-	return float(pow(dX.x, 2) + pow(dY.y, 2));
+// Thomas algorithm for two right-hand sides sharing one tridiagonal matrix.
+// upper is used as scratch; the solutions overwrite rhsX and rhsY.
+template <typename Real>
+static void solveTridiagonal(int n, const Real* lower, const Real* diag, Real* upper, Real* rhsX, Real* rhsY) {
+	upper[0] /= diag[0];
+	rhsX[0] /= diag[0];
+	rhsY[0] /= diag[0];
+	for (int m = 1; m < n; m++) {
+		Real denom = diag[m] - lower[m] * upper[m - 1];
+		upper[m] /= denom;
+		rhsX[m] = (rhsX[m] - lower[m] * rhsX[m - 1]) / denom;
+		rhsY[m] = (rhsY[m] - lower[m] * rhsY[m - 1]) / denom;
+	}
+	for (int m = n - 2; m >= 0; m--) {
+		rhsX[m] -= upper[m] * rhsX[m + 1];
+		rhsY[m] -= upper[m] * rhsY[m + 1];
+	}
 }
 
-vector<float> Rectangular::getCoeff(int i, float dXi, float dEta) {
-	float a = alpha(i, dXi, dEta);
-	float b = beta(i, dXi, dEta);
-	float g = gamma(i, dXi, dEta);
+template <typename Real>
+Real Rectangular<Real>::relaxLine(int start, int step, int count, Real dXi, Real dEta, Real omega, vector<Real>& scratch) {
+	// Nodes start + m * step are solved implicitly, the rest of the stencil is lagged.
+	// The along-line neighbours are W/E (coefficients 3, 4) for i-lines and S/N (1, 6) for j-lines.
+	Real* X = mesh.x();
+	Real* Y = mesh.y();
+	int stride = mesh.stride;
+	const int offsets[8] = { -1 - stride, -stride, 1 - stride, -1, 1, -1 + stride, stride, 1 + stride };
+	int lowerId = step == 1 ? 3 : 1;
+	int upperId = step == 1 ? 4 : 6;
+
+	scratch.resize(5 * count);
+	Real* lower = scratch.data();
+	Real* diag = lower + count;
+	Real* upper = diag + count;
+	Real* rhsX = upper + count;
+	Real* rhsY = rhsX + count;
+
+	for (int m = 0; m < count; m++) {
+		int k = start + m * step;
+		Real coeff[8];
+		if (stretchXi.empty()) {
+			winslowCoeff(dx(k, dXi, dEta), dy(k, dXi, dEta), dXi, dEta, coeff);
+		}
+		else {
+			winslowCoeff(dx(k, dXi, dEta), dy(k, dXi, dEta), dXi, dEta, coeff, stretchXi[k % stride], stretchEta[k / stride]);
+		}
 
-	float mult = 1 / (2 * (a / (dXi * dXi)) + 2 * (g / (dEta * dEta)));
-	float a1 = -(mult * b) / (2 * dXi * dEta);
-	float a2 = (mult * g) / (dEta * dEta);
-	float a3 = (mult * b) / (2 * dXi * dEta);
-	float a4 = (mult * a) / (dXi * dXi);
-	float a5 = a4;
-	float a6 = a3;
-	float a7 = a2;
-	float a8 = a1;
-	return { a1, a2, a3, a4, a5, a6, a7, a8 };
+		lower[m] = -coeff[lowerId];
+		diag[m] = Real(1);
+		upper[m] = -coeff[upperId];
+		rhsX[m] = Real(0);
+		rhsY[m] = Real(0);
+		for (int c = 0; c < 8; c++) {
+			if (c == lowerId || c == upperId) continue;
+			rhsX[m] += coeff[c] * X[k + offsets[c]];
+			rhsY[m] += coeff[c] * Y[k + offsets[c]];
+		}
+	}
+
+	// The line ends touch boundary nodes, which are known
+	rhsX[0] -= lower[0] * X[start - step];
+	rhsY[0] -= lower[0] * Y[start - step];
+	rhsX[count - 1] -= upper[count - 1] * X[start + count * step];
+	rhsY[count - 1] -= upper[count - 1] * Y[start + count * step];
+	lower[0] = Real(0);
+	upper[count - 1] = Real(0);
+
+	solveTridiagonal(count, lower, diag, upper, rhsX, rhsY);
+
+	Real maxChange = Real(0);
+	for (int m = 0; m < count; m++) {
+		int k = start + m * step;
+		Real newX = X[k] + omega * (rhsX[m] - X[k]);
+		Real newY = Y[k] + omega * (rhsY[m] - Y[k]);
+		maxChange = max(maxChange, (Real) max(fabs(newX - X[k]), fabs(newY - Y[k])));
+		X[k] = newX;
+		Y[k] = newY;
+	}
+	return maxChange;
 }
 
-void Rectangular::enforceICs(float dXi, float dEta, float& maxChange) {
-	for (int i = 0; i < N; i++) {
-		if ((i % iMax != 0 && i % iMax != iMax - 1) && (i / iMax != 0 && i / iMax != jMax - 1)) {
-			vector<float> coeff = getCoeff(i, dXi, dEta);
-
-			float newX = coeff[0] * points[i - 1 - iMax].x
-						+ coeff[1] * points[i - iMax].x
-						+ coeff[2] * points[i + 1 - iMax].x
-						+ coeff[3] * points[i - 1].x
-						+ coeff[4] * points[i + 1].x
-						+ coeff[5] * points[i - 1 + iMax].x
-						+ coeff[6] * points[i + iMax].x
-						+ coeff[7] * points[i + 1 + iMax].x;
-
-			float newY = coeff[0] * points[i - 1 - iMax].y
-						+ coeff[1] * points[i - iMax].y
-						+ coeff[2] * points[i + 1 - iMax].y
-						+ coeff[3] * points[i - 1].y
-						+ coeff[4] * points[i + 1].y
-						+ coeff[5] * points[i - 1 + iMax].y
-						+ coeff[6] * points[i + iMax].y
-						+ coeff[7] * points[i + 1 + iMax].y;
-
-			maxChange = max(maxChange, (float) max(fabs(newX - points[i].x), fabs(newY - points[i].y)));
-
-			points[i] = { newX, newY };
+template <typename Real>
+void Rectangular<Real>::enforceICsLineSOR(Real dXi, Real dEta, Real omega, Real& maxChange, ThreadPool& pool) {
+	// One ADI-style iteration: i-lines, then j-lines. Lines only couple to their direct
+	// neighbours, so odd and even lines (zebra ordering) can each be solved in parallel.
+	vector<Real> threadMax(pool.size(), Real(0));
+	vector<vector<Real>> scratch(pool.size());
+
+	for (int parity = 0; parity < 2; parity++) {
+		int rows = (jMax - 1 - parity) / 2;
+		pool.parallelFor(0, rows, [&](int rowBegin, int rowEnd, int thread) {
+			for (int row = rowBegin; row < rowEnd; row++) {
+				int j = 1 + parity + 2 * row;
+				Real change = relaxLine(mesh.index(1, j), 1, iMax - 2, dXi, dEta, omega, scratch[thread]);
+				threadMax[thread] = max(threadMax[thread], change);
+			}
+		});
+	}
+
+	for (int parity = 0; parity < 2; parity++) {
+		int columns = (iMax - 1 - parity) / 2;
+		pool.parallelFor(0, columns, [&](int columnBegin, int columnEnd, int thread) {
+			for (int column = columnBegin; column < columnEnd; column++) {
+				int i = 1 + parity + 2 * column;
+				Real change = relaxLine(mesh.index(i, 1), mesh.stride, jMax - 2, dXi, dEta, omega, scratch[thread]);
+				threadMax[thread] = max(threadMax[thread], change);
+			}
+		});
+	}
+
+	for (Real change : threadMax) {
+		maxChange = max(maxChange, change);
+	}
+}
+
+template <typename Real>
+void Rectangular<Real>::enforceICsTiled(Real dXi, Real dEta, int sweeps, Real& maxChange) {
+	// Temporal blocking of the four-colour sweep. One colour sweep is equivalent to relaxing
+	// whole rows (both colours) in the order 1, 3, 2, 5, 4, 7, 6, ...: an odd row needs its even
+	// neighbours from the previous sweep, an even row its odd neighbours from this one. Sweep s
+	// trails sweep s - 1 by three positions of that order, so every sweep sees exactly the data
+	// enforceICsRedBlack would, but only a band of about 3 * sweeps rows is touched per step and
+	// stays in cache instead of streaming the planes from memory once per colour.
+	// maxChange is that of the last sweep.
+	static const ColourRowKernel<Real> relaxRow = colourRowKernel<Real>(detectSimdLevel());
+	const int lag = 3;
+	int positions = jMax - 1;
+	int steps = positions + lag * (sweeps - 1);
+
+	for (int step = 0; step < steps; step++) {
+		for (int s = 0; s < sweeps; s++) {
+			int q = step - lag * s;
+			if (q < 0 || q >= positions) continue;
+			int j = q == 0 ? 1 : (q % 2 == 1 ? q + 2 : q);
+			if (j > jMax - 2) continue;
+
+			Real change;
+			if (stretchXi.empty()) {
+				change = relaxRow(mesh.x(), mesh.y(), mesh.index(1, j), (iMax - 1) / 2, mesh.stride, dXi, dEta);
+				change = max(change, relaxRow(mesh.x(), mesh.y(), mesh.index(2, j), (iMax - 2) / 2, mesh.stride, dXi, dEta));
+			}
+			else {
+				change = relaxRowStretched(1, j, (iMax - 1) / 2, dXi, dEta);
+				change = max(change, relaxRowStretched(2, j, (iMax - 2) / 2, dXi, dEta));
+			}
+			if (s == sweeps - 1) maxChange = max(maxChange, change);
+		}
+	}
+}
+
+template <typename Real>
+Real Rectangular<Real>::relaxRowStretched(int i, int j, int count, Real dXi, Real dEta) {
+	// Scalar stand-in for the colour row kernels while control functions are active
+	Real maxChange = Real(0);
+	for (int n = 0; n < count; n++) {
+		int column = i + 2 * n;
+		maxChange = max(maxChange, relaxWinslowNode(mesh.x(), mesh.y(), mesh.index(column, j), mesh.stride, dXi, dEta, stretchXi[column], stretchEta[j]));
+	}
+	return maxChange;
+}
+
+template <typename Real>
+Real Rectangular<Real>::enforceICsMixed(Real dXi, Real dEta, int sweeps, CorrectionPlanes& planes) {
+	// Defect correction. With the stencil coefficients C frozen at the current points u, the
+	// update e that makes u + e a fixed point of the sweep solves e = C e + r with r = C u - u.
+	// r and C are evaluated in Real, e is relaxed in float and added back in Real, so the float
+	// round-off only limits how far one pass gets, not how far the iteration converges.
+	// Returns max |r|, the change a sweep of the Real solution would make.
+	Real* X = mesh.x();
+	Real* Y = mesh.y();
+	int stride = mesh.stride;
+	const int offsets[8] = { -1 - stride, -stride, 1 - stride, -1, 1, -1 + stride, stride, 1 + stride };
+
+	MeshPlanes<float>& e = planes.correction;
+	MeshPlanes<float>& r = planes.residual;
+	Real maxResidual = Real(0);
+
+	for (int j = 1; j < jMax - 1; j++) {
+		for (int i = 1; i < iMax - 1; i++) {
+			int k = mesh.index(i, j);
+			int c = e.index(i, j);
+
+			Real coeff[8];
+			if (stretchXi.empty()) {
+				winslowCoeff(dx(k, dXi, dEta), dy(k, dXi, dEta), dXi, dEta, coeff);
+			}
+			else {
+				winslowCoeff(dx(k, dXi, dEta), dy(k, dXi, dEta), dXi, dEta, coeff, stretchXi[i], stretchEta[j]);
+			}
+			Real resX = -X[k], resY = -Y[k];
+			for (int m = 0; m < 8; m++) {
+				resX += coeff[m] * X[k + offsets[m]];
+				resY += coeff[m] * Y[k + offsets[m]];
+			}
+			maxResidual = max(maxResidual, (Real) max(fabs(resX), fabs(resY)));
+
+			r.setNode(c, { float(resX), float(resY) });
+			e.setNode(c, { 0.f, 0.f });
+			// The correction is relaxed with the mean of opposite neighbours, which only differ with
+			// control functions; r is exact, so this slows the correction but not the result
+			planes.cW[c] = float((coeff[3] + coeff[4]) / 2);
+			planes.cS[c] = float((coeff[1] + coeff[6]) / 2);
+			planes.corner[c] = float(coeff[2]);
+		}
+	}
+
+	// Lexicographic Gauss-Seidel on the linear correction equation, e = 0 on the boundary
+	float* eX = e.x();
+	float* eY = e.y();
+	const float* rX = r.x();
+	const float* rY = r.y();
+	int s = e.stride;
+	for (int sweep = 0; sweep < sweeps; sweep++) {
+		for (int j = 1; j < jMax - 1; j++) {
+			for (int i = 1; i < iMax - 1; i++) {
+				int c = e.index(i, j);
+				float cW = planes.cW[c], cS = planes.cS[c], corner = planes.corner[c];
+				eX[c] = cW * (eX[c - 1] + eX[c + 1]) + cS * (eX[c - s] + eX[c + s])
+					+ corner * (eX[c + 1 - s] + eX[c - 1 + s] - eX[c - 1 - s] - eX[c + 1 + s]) + rX[c];
+				eY[c] = cW * (eY[c - 1] + eY[c + 1]) + cS * (eY[c - s] + eY[c + s])
+					+ corner * (eY[c + 1 - s] + eY[c - 1 + s] - eY[c - 1 - s] - eY[c + 1 + s]) + rY[c];
+			}
+		}
+	}
+
+	for (int j = 1; j < jMax - 1; j++) {
+		for (int i = 1; i < iMax - 1; i++) {
+			int k = mesh.index(i, j);
+			int c = e.index(i, j);
+			X[k] += Real(eX[c]);
+			Y[k] += Real(eY[c]);
 		}
 	}
+	return maxResidual;
 }
 
-void Rectangular::gaussSeibel(int maxIterations) {
+template <typename Real>
+void Rectangular<Real>::gaussSeibel(int maxIterations) {
 	bool converged = false;
-	int iteration = 0;
+	if (!resumed) sweep = SweepState();
+	resumed = false;
+	int& iteration = sweep.iteration;
 
-	float dXi = 1.f / float(iMax - 1);
-	float dEta = 1.f / float(jMax - 1);
+	Real dXi = Real(1) / Real(iMax - 1);
+	Real dEta = Real(1) / Real(jMax - 1);
+
+	// Tiled and mixed-precision passes count as one iteration per sweep, with the boundary
+	// conditions applied once per pass
+	int sweeps = 1;
+	if (settings.mixedPrecision) sweeps = max(settings.correctionInterval, 1);
+	else if (settings.sweepMode == SweepMode::Tiled) sweeps = max(settings.tileSweeps, 1);
+
+	std::unique_ptr<ThreadPool> pool;
+	if (!settings.mixedPrecision && (settings.sweepMode == SweepMode::RedBlack || settings.sweepMode == SweepMode::LineSOR)) {
+		pool = std::make_unique<ThreadPool>(settings.numThreads);
+	}
+	std::unique_ptr<ThreadPool> qualityPool;
+	if (settings.qualityInterval > 0 && !pool) {
+		qualityPool = std::make_unique<ThreadPool>(settings.numThreads);
+	}
+
+	CorrectionPlanes planes;
+	if (settings.mixedPrecision) {
+		planes.correction = MeshPlanes<float>(iMax, jMax);
+		planes.residual = MeshPlanes<float>(iMax, jMax);
+		planes.cW.assign(std::size_t(planes.correction.stride) * jMax, 0.f);
+		planes.cS = planes.cW;
+		planes.corner = planes.cW;
+	}
+
+	// Line SOR starts out as line Gauss-Seidel and takes its relaxation factor from the
+	// contraction rate observed over the first iterations, omega = 2 / (1 + sqrt(1 - rho))
+	const int tuneStart = 10, tuneEnd = 30;
+	Real& omega = sweep.omega;
+	Real& tuneChange = sweep.tuneChange;
+	Real& previousChange = sweep.previousChange;
+	int& growing = sweep.growing;
+
+	if (settings.checkpointSeconds > 0 && settings.checkpointPath.empty()) {
+		throw std::invalid_argument("Checkpoints need a checkpoint path");
+	}
+	using Clock = std::chrono::steady_clock;
+	auto checkpointInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settings.checkpointSeconds));
+	Clock::time_point nextCheckpoint = Clock::now() + checkpointInterval;
+
+	Telemetry* telemetry = settings.telemetry;
+	if (telemetry) telemetry->begin("Gauss-Seidel");
+	Real maxChange = Real(0);
+	MeshQuality stopQuality;
+	bool qualityStop = false;
 
 	while (!converged) {
-		float maxChange = 0.0;
+		maxChange = Real(0);
+
+		enforceBCs(dEta);
+		if (settings.mixedPrecision) {
+			maxChange = enforceICsMixed(dXi, dEta, sweeps, planes);
+		}
+		else if (settings.sweepMode == SweepMode::LineSOR) {
+			enforceICsLineSOR(dXi, dEta, omega, maxChange, *pool);
+
+			if (iteration == tuneStart) tuneChange = maxChange;
+			if (iteration == tuneEnd && tuneChange > Real(0)) {
+				Real rho = min(pow(maxChange / tuneChange, Real(1) / Real(tuneEnd - tuneStart)), Real(0.999));
+				omega = min(Real(2) / (Real(1) + std::sqrt(Real(1) - rho)), Real(1.95));
+			}
+			// The coefficients are solution dependent, back off if the factor overshoots
+			growing = maxChange > previousChange ? growing + 1 : 0;
+			if (iteration > tuneEnd && growing >= 3) {
+				omega = Real(1) + Real(0.5) * (omega - Real(1));
+				growing = 0;
+			}
+			previousChange = maxChange;
+		}
+		else if (settings.sweepMode == SweepMode::Tiled) {
+			enforceICsTiled(dXi, dEta, sweeps, maxChange);
+		}
+		else if (pool) {
+			enforceICsRedBlack(dXi, dEta, maxChange, *pool);
+		}
+		else {
+			enforceICs(dXi, dEta, maxChange);
+		}
+
+		converged = maxChange < settings.tolerance || iteration > maxIterations;
+		int previous = iteration;
+		iteration += sweeps;
+
+		int interval = settings.qualityInterval;
+		if (!converged && interval > 0 && iteration / interval != previous / interval) {
+			stopQuality = meshQuality(mesh, pool ? pool.get() : qualityPool.get());
+			qualityStop = converged = meetsTargets(stopQuality, settings.qualityTargets);
+		}
+		if (telemetry) telemetry->post(iteration, maxChange);
+		if (settings.snapshots && settings.snapshots->due(previous, iteration)) {
+			settings.snapshots->capture(mesh, iteration);
+		}
+
+		sweep.lastChange = maxChange;
+		if (!converged && settings.checkpointSeconds > 0 && Clock::now() >= nextCheckpoint) {
+			writeCheckpoint(settings.checkpointPath);
+			nextCheckpoint = Clock::now() + checkpointInterval;
+		}
+	}
+	if (telemetry) telemetry->end(iteration, maxChange, qualityStop ? &stopQuality : nullptr);
+	if (!settings.outputFile.empty()) writePointsTecplot(settings.outputFile);
+}
+
+namespace {
+
+const char checkpointMagic[8] = { 'R', 'E', 'C', 'T', 'C', 'K', 'P', '1' };
+
+// The solver parameters of SolverSettings a checkpoint keeps, in file order
+template <typename Settings, typename Field>
+void checkpointFields(Settings& s, Field&& field) {
+	field(s.solver);
+	field(s.initialGuess);
+	field(s.sweepMode);
+	field(s.tolerance);
+	field(s.tileSweeps);
+	field(s.mixedPrecision);
+	field(s.correctionInterval);
+	field(s.qualityInterval);
+	field(s.qualityTargets.maxSkewness);
+	field(s.qualityTargets.maxAspectRatio);
+	field(s.qualityTargets.maxWallDeviation);
+	for (auto* clustering : { &s.xiClustering, &s.etaClustering }) {
+		field(clustering->stretching);
+		field(clustering->strength);
+		field(clustering->firstCell);
+		field(clustering->twoSided);
+	}
+	field(s.controlFunctions);
+	field(s.maxCycles);
+	field(s.preSmooth);
+	field(s.postSmooth);
+	field(s.fullMultigrid);
+	field(s.maxNewtonSteps);
+	field(s.krylovDim);
+	field(s.krylovRestarts);
+	field(s.preconditionSweeps);
+}
+
+}
+
+template <typename Real>
+void Rectangular<Real>::writeCheckpoint(const std::string& filename) {
+	vector<char> bytes;
+	bytes.reserve(256 + 2 * sizeof(Real) * std::size_t(N));
+	auto put = [&](const auto& value) {
+		const char* p = reinterpret_cast<const char*>(&value);
+		bytes.insert(bytes.end(), p, p + sizeof(value));
+	};
+
+	bytes.insert(bytes.end(), checkpointMagic, checkpointMagic + sizeof(checkpointMagic));
+	put(int(sizeof(Real)));
+	put(iMax);
+	put(jMax);
+	put(x_W);
+	put(x_E);
+	checkpointFields(settings, put);
+	put(sweep.iteration);
+	put(sweep.lastChange);
+	put(sweep.omega);
+	put(sweep.tuneChange);
+	put(sweep.previousChange);
+	put(sweep.growing);
+	for (const Real* plane : { mesh.x(), mesh.y() }) {
+		for (int j = 0; j < jMax; j++) {
+			const char* row = reinterpret_cast<const char*>(plane + mesh.index(0, j));
+			bytes.insert(bytes.end(), row, row + sizeof(Real) * iMax);
+		}
+	}
+
+	std::string temporary = filename + ".tmp";
+	std::ofstream outFile(temporary, std::ios::binary);
+	if (!outFile) {
+		throw std::runtime_error("Failed to open file: " + temporary);
+	}
+	outFile.write(bytes.data(), std::streamsize(bytes.size()));
+	outFile.close();
+	if (!outFile || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+		throw std::runtime_error("Failed to write checkpoint: " + filename);
+	}
+}
+
+template <typename Real>
+typename Rectangular<Real>::Checkpoint Rectangular<Real>::readCheckpoint(const std::string& filename) {
+	std::ifstream inFile(filename, std::ios::binary);
+	if (!inFile) {
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+	vector<char> bytes((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+
+	std::size_t offset = 0;
+	auto get = [&](auto& value) {
+		if (bytes.size() - offset < sizeof(value)) {
+			throw std::runtime_error("Truncated checkpoint: " + filename);
+		}
+		std::memcpy(&value, bytes.data() + offset, sizeof(value));
+		offset += sizeof(value);
+	};
+
+	char magic[sizeof(checkpointMagic)];
+	get(magic);
+	if (std::memcmp(magic, checkpointMagic, sizeof(magic)) != 0) {
+		throw std::runtime_error("Not a checkpoint: " + filename);
+	}
+	int realSize;
+	get(realSize);
+	if (realSize != int(sizeof(Real))) {
+		throw std::runtime_error("Checkpoint of another floating-point type: " + filename);
+	}
 
-		enforceBCs(dXi, dEta);
-		enforceICs(dXi, dEta, maxChange);
+	Checkpoint checkpoint;
+	get(checkpoint.iMax);
+	get(checkpoint.jMax);
+	get(checkpoint.x_W);
+	get(checkpoint.x_E);
+	checkpointFields(checkpoint.settings, get);
+	get(checkpoint.sweep.iteration);
+	get(checkpoint.sweep.lastChange);
+	get(checkpoint.sweep.omega);
+	get(checkpoint.sweep.tuneChange);
+	get(checkpoint.sweep.previousChange);
+	get(checkpoint.sweep.growing);
+	if (checkpoint.iMax < 2 || checkpoint.jMax < 2) {
+		throw std::runtime_error("No I x J grid in checkpoint: " + filename);
+	}
+
+	std::size_t count = std::size_t(checkpoint.iMax) * checkpoint.jMax;
+	for (vector<Real>* plane : { &checkpoint.x, &checkpoint.y }) {
+		plane->resize(count);
+		if (bytes.size() - offset < count * sizeof(Real)) {
+			throw std::runtime_error("Truncated checkpoint: " + filename);
+		}
+		std::memcpy(plane->data(), bytes.data() + offset, count * sizeof(Real));
+		offset += count * sizeof(Real);
+	}
+	return checkpoint;
+}
+
+template <typename Real>
+Rectangular<Real>::Rectangular(Checkpoint checkpoint, Channel channel, SolverSettings settings)
+	: iMax(checkpoint.iMax), jMax(checkpoint.jMax), N(iMax * jMax), settings(checkpoint.settings), south(channel.south), north(channel.north),
+	  x_W(channel.x_W), x_E(channel.x_E) {
+	if (checkpoint.x_W != x_W || checkpoint.x_E != x_E) {
+		throw std::invalid_argument("Checkpoint was written for a channel between other sides");
+	}
+	this->settings.numThreads = settings.numThreads;
+	this->settings.telemetry = settings.telemetry;
+	this->settings.outputFile = settings.outputFile;
+	this->settings.snapshots = settings.snapshots;
+	this->settings.checkpointPath = settings.checkpointPath;
+	this->settings.checkpointSeconds = settings.checkpointSeconds;
 
-		converged = maxChange < 9e-7 || iteration > maxIterations;
-		iteration++;
-		if (iteration % 5 == 0) {
-			cout << "Iteration: " << iteration << ", Max Change: " << maxChange << endl;
-			// writePointsTecplot("OG/Orthogonal_Grid_" + std::to_string(iteration) + ".dat");
+	createPoints();
+	createClustering();
+	createBoundary();
+	for (int j = 0; j < jMax; j++) {
+		for (int i = 0; i < iMax; i++) {
+			mesh.x()[mesh.index(i, j)] = checkpoint.x[std::size_t(j) * iMax + i];
+			mesh.y()[mesh.index(i, j)] = checkpoint.y[std::size_t(j) * iMax + i];
 		}
 	}
-	writePointsTecplot("Orthogonal_Grid.dat");
+	sweep = checkpoint.sweep;
+	resumed = true;
+	solve();
+	createRectangles();
 }
 
-void Rectangular::createRectangles() {
+template <typename Real>
+void Rectangular<Real>::multigrid(int maxCycles) {
+	if (settings.sweepMode == SweepMode::LineSOR || settings.sweepMode == SweepMode::Tiled) {
+		throw std::invalid_argument("Multigrid smooths lexicographically or red-black only");
+	}
+	if (settings.mixedPrecision) {
+		throw std::invalid_argument("Mixed precision is Gauss-Seidel only");
+	}
+	Multigrid<Real> solver(*this);
+	if (solver.levelCount() < 2) {
+		throw std::invalid_argument("Grid too small for multigrid, it needs 8 nodes along a direction to coarsen");
+	}
+	solver.solve(maxCycles);
+	if (!settings.outputFile.empty()) writePointsTecplot(settings.outputFile);
+}
+
+template <typename Real>
+void Rectangular<Real>::newtonKrylov(int maxSteps) {
+	NewtonKrylov<Real> solver(*this);
+	solver.solve(maxSteps);
+	if (!settings.outputFile.empty()) writePointsTecplot(settings.outputFile);
+}
+
+vector<Rectangle> structuredRectangles(int iMax, int jMax) {
+	vector<Rectangle> rectangles;
 	for (int i = 0; i < jMax - 1; i++) {
 		for (int j = 0; j < iMax - 1; j++) {
 			Rectangle newRect;
@@ -237,9 +993,23 @@ void Rectangular::createRectangles() {
 		if (i % (iMax - 1) == 0) rectangles[i].edges[2] = -1;
 		if (i / (iMax - 1) == 0) rectangles[i].edges[3] = -1;
 	}
+	return rectangles;
 }
 
-void Rectangular::printRectangles() {
+template <typename Real>
+void Rectangular<Real>::createRectangles() {
+	rectangles = structuredRectangles(iMax, jMax);
+}
+
+template <typename Real>
+MeshQuality Rectangular<Real>::quality() {
+	ThreadPool pool(settings.numThreads);
+	return meshQuality(mesh, &pool);
+}
+
+template <typename Real>
+void Rectangular<Real>::printRectangles() {
+	vector<BasicNode<Real>> points = mesh.toNodes();
 	int width = static_cast<int>(log10(max(rectangles.size() * 4, points.size())) + 1);
 
 	cout << "Rectangle Vertices: " << endl;
@@ -269,4 +1039,7 @@ void Rectangular::printRectangles() {
 			<< setw(8) << points[i].y << endl;
 	}
 	cout << endl;
-}
\ No newline at end of file
+}
+
+template class Rectangular<float>;
+template class Rectangular<double>;
@@ -2,57 +2,289 @@
 #define RECTANGULAR_H
 
 #include "geometry.h"
+#include "clustering.h"
+#include "meshplanes.h"
+#include "quality.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "threadpool.h"
+#include <functional>
 
 # define M_PI           3.14159265358979323846
 
 using std::cout, std::endl, std::pair, std::vector, std::pow, std::max;
 
+enum class SweepMode {
+	Lexicographic,	// node by node in index order on one thread
+	RedBlack,		// four colours by (i, j) parity, each colour relaxed in parallel
+	LineSOR,		// alternating i- and j-line SOR with tridiagonal solves, zebra ordered in parallel
+	Tiled			// four colours as RedBlack, several sweeps pipelined over a cache-resident band of rows
+};
+
+enum class Solver {
+	GaussSeidel,	// point relaxation until converged
+	Multigrid,		// FAS V-cycles over coarsened (iMax, jMax) levels
+	NewtonKrylov	// Jacobian-free Newton-Krylov, quadratic convergence near the solution
+};
+
+enum class InitialGuess {
+	Shear,		// interior nodes evenly spaced on vertical lines between the walls
+	TFI,		// transfinite interpolation of the four boundary curves
+	HermiteTFI	// as TFI, but cubic across the channel and orthogonal to the walls
+};
+
+struct SolverSettings {
+	Solver solver = Solver::GaussSeidel;
+	InitialGuess initialGuess = InitialGuess::Shear;	// HermiteTFI starts closer to orthogonal walls
+	SweepMode sweepMode = SweepMode::Lexicographic;
+	int numThreads = 0;	// 0 uses every hardware thread
+	// Stop once a sweep, V-cycle or Newton step moves no node by more than this. Multigrid and
+	// Newton-Krylov raise it to the round-off floor of the grid's type, 8 ulp of its largest
+	// coordinate, where that is larger: about 5e-6 for Rectangular<float> on the default channel.
+	float tolerance = 9e-7f;
+	Telemetry* telemetry = nullptr;	// progress reporting, the solvers are silent without one
+	std::string outputFile = "Orthogonal_Grid.dat";	// Tecplot file written after the solve, none when empty
+	SnapshotWriter* snapshots = nullptr;	// Gauss-Seidel only: grid dumps at the writer's cadence
+	int tileSweeps = 8;	// Tiled only: sweeps per pass, the band spans about 3 * tileSweeps rows
+
+	// Gauss-Seidel only: relax a correction in float between residual evaluations in the grid's own
+	// precision, e.g. float bandwidth with a double solution and convergence test for Rectangular<double>
+	bool mixedPrecision = false;
+	int correctionInterval = 10;	// float sweeps per residual evaluation
+
+	// Gauss-Seidel only: also stop as soon as the grid meets qualityTargets, evaluated every
+	// qualityInterval iterations (0 never), instead of relaxing on until the tolerance is reached.
+	// After such a stop quality() is the quality it was judged on, which the last telemetry
+	// sample carries as well.
+	int qualityInterval = 0;
+	QualityTargets qualityTargets;
+
+	// Gauss-Seidel only: save the solve to checkpointPath every checkpointSeconds of wall time
+	// (0 never), to be resumed with the checkpoint constructor of Rectangular. A solve with
+	// checkpoints and no path, or with another solver, throws std::invalid_argument.
+	std::string checkpointPath;
+	double checkpointSeconds = 0;
+
+	// Node distribution of the initial guess along xi (west to east) and eta (south to north).
+	// With control functions the solver keeps it, otherwise it relaxes towards even spacing.
+	// Vector kernels are bypassed while control functions are active.
+	Clustering xiClustering, etaClustering;
+	bool controlFunctions = true;
+
+	// Multigrid only. It smooths Lexicographic or RedBlack, other sweep modes and mixedPrecision
+	// are rejected, as are grids too small to coarsen.
+	int maxCycles = 100;
+	int preSmooth = 2;
+	int postSmooth = 2;
+	bool fullMultigrid = true;	// start from a nested-iteration (FMG) initial guess
+
+	// Newton-Krylov only
+	int maxNewtonSteps = 50;
+	int krylovDim = 30;				// GMRES restart length
+	int krylovRestarts = 20;
+	int preconditionSweeps = 4;		// Gauss-Seidel sweeps per preconditioner application
+};
+
+// South or north wall. Nodes with x in [xBegin, xEnd] slide along y(x) and are kept orthogonal
+// to it through slope = dy/dx; elsewhere the wall is flat and nodes copy x from the interior.
+struct WallShape {
+	std::function<double(double)> y;
+	std::function<double(double)> slope;
+	double xBegin, xEnd;
+};
+
+// Flat wall at base with a half sine bump of the given height between xBegin and xEnd
+WallShape sineBump(double base, double height, double xBegin, double xEnd);
+
+// Channel between the south and north walls and the vertical sides x = x_W and x = x_E
+struct Channel {
+	WallShape south, north;
+	double x_W = 0.0, x_E = 5.0;
+};
+
+// The default channel, 5 x 1 with a bump of the given height on both walls between x = 2 and 3
+Channel bumpChannel(double height = 0.1);
+
+// Row-major points of an iMax x jMax grid, e.g. a converged grid to warm-start another one from
+template <typename Real>
+struct GridPoints {
+	int iMax = 0, jMax = 0;
+	vector<BasicNode<Real>> points;
+};
+
+// The grid as a single Tecplot POINT zone, as read back by Rectangular::readPointsTecplot
+template <typename Real>
+void writeGridTecplot(const std::string& filename, const GridPoints<Real>& grid);
+
+// Several grids as Tecplot POINT zones titled zoneTitle and their index, e.g. the blocks of a MultiBlock
+template <typename Real>
+void writeGridTecplot(const std::string& filename, const vector<GridPoints<Real>>& zones, const std::string& zoneTitle);
+
 struct Rectangle : Polygon {
 	Rectangle() : Polygon(4, -1) {}
 
 };
 
+// Cells of an iMax x jMax structured grid over row-major points, with their neighbours across
+// the east, north, west and south edges (-1 on the boundary)
+vector<Rectangle> structuredRectangles(int iMax, int jMax);
+
+template <typename Real = float>
 class Rectangular : public Geometry {
 public:
-	Rectangular(int iMax, int jMax) : iMax(iMax), jMax(jMax), N(iMax * jMax) {
+	Rectangular(int iMax, int jMax, SolverSettings settings = {})
+		: Rectangular(iMax, jMax, bumpChannel(), settings) {}
+
+	Rectangular(int iMax, int jMax, Channel channel, SolverSettings settings = {})
+		: iMax(iMax), jMax(jMax), N(iMax * jMax), settings(settings), south(channel.south), north(channel.north), x_W(channel.x_W), x_E(channel.x_E) {
+		createPoints();
+		createClustering();
+		createBoundary();
+		initialGuess();
+		solve();
+		createRectangles();
+	};
+
+	// Starts from a previous grid instead of settings.initialGuess. start may have another
+	// resolution and belong to another channel; it is interpolated onto this one.
+	Rectangular(int iMax, int jMax, Channel channel, const GridPoints<Real>& start, SolverSettings settings = {})
+		: iMax(iMax), jMax(jMax), N(iMax * jMax), settings(settings), south(channel.south), north(channel.north), x_W(channel.x_W), x_E(channel.x_E) {
 		createPoints();
-		clusterPoints();
-		transformXY(0.f, 5.f);
-		gaussSeibel(15000);
+		createClustering();
+		createBoundary();
+		warmStart(start);
+		solve();
 		createRectangles();
 	};
 
-	vector<Node> getPoints() { return points; }
+	// Resumes a solve from a checkpoint, bit-identically to the run that wrote it. The walls are
+	// functions and are not saved, so channel has to be the one of that run. The solver settings
+	// are the saved ones, only numThreads and the telemetry, output, snapshot and checkpoint
+	// settings are taken from settings.
+	Rectangular(const std::string& checkpoint, Channel channel, SolverSettings settings = {})
+		: Rectangular(readCheckpoint(checkpoint), std::move(channel), settings) {}
+
+	vector<BasicNode<Real>> getPoints() { return mesh.toNodes(); }
+	GridPoints<Real> getGridPoints() { return { iMax, jMax, mesh.toNodes() }; }
 	vector<Rectangle> getRectangles() { return rectangles; }
 
 	void gaussSeibel(int maxIterations);
+	void multigrid(int maxCycles);
+	void newtonKrylov(int maxSteps);
 	void createRectangles();
 	void printRectangles();
 
+	// Quality of the grid as it currently is, evaluated on settings.numThreads threads
+	MeshQuality quality();
+
 	void writePointsTecplot(const std::string& filename);
+	static GridPoints<Real> readPointsTecplot(const std::string& filename);
+
+	// Binary points, settings and Gauss-Seidel progress, written to filename + ".tmp" in one
+	// write and then renamed over filename, so a run killed meanwhile leaves the last one intact
+	void writeCheckpoint(const std::string& filename);
 
 private:
+	template <typename> friend class Multigrid;
+	template <typename> friend class NewtonKrylov;
+	template <typename> friend class MultiBlock;
+
+	// Block of a MultiBlock: only the initial guess, the solve is driven by the container. Sides
+	// flagged as interfaces are halo columns filled by the neighbour block, not boundaries.
+	// xiNodes overrides settings.xiClustering when it has iMax entries.
+	Rectangular(int iMax, int jMax, Channel channel, SolverSettings settings, vector<double> xiNodes, bool westInterface, bool eastInterface)
+		: iMax(iMax), jMax(jMax), N(iMax * jMax), settings(settings), south(channel.south), north(channel.north), x_W(channel.x_W), x_E(channel.x_E),
+		  westInterface(westInterface), eastInterface(eastInterface), xiNodes(std::move(xiNodes)) {
+		createPoints();
+		createClustering();
+		createBoundary();
+		initialGuess();
+	}
+
+	// Progress of gaussSeibel, kept here so a checkpoint can save it and a resumed run pick it up
+	struct SweepState {
+		int iteration = 0;
+		Real lastChange = 0;
+		Real omega = 1, tuneChange = 0, previousChange = 0;	// LineSOR tuning
+		int growing = 0;
+	};
+
+	struct Checkpoint {
+		int iMax, jMax;
+		double x_W, x_E;
+		SolverSettings settings;
+		SweepState sweep;
+		vector<Real> x, y;	// row-major
+	};
+	static Checkpoint readCheckpoint(const std::string& filename);
+
+	Rectangular(Checkpoint checkpoint, Channel channel, SolverSettings settings);
+
 	int iMax, jMax;
 	int N;
+	SolverSettings settings;
+	WallShape south, north;
+	double x_W, x_E;
+	bool westInterface = false, eastInterface = false;
+
+	// A node on the outside of the grid. wall and side are 1 on the south / west boundary and -1 on
+	// the north / east one, i.e. the step towards the interior, and 0 otherwise.
+	struct BoundaryNode {
+		int k;
+		int wall;
+		int side;
+	};
+	vector<BoundaryNode> boundary;
+	std::size_t southEnd = 0, northBegin = 0;	// boundary is the south row, the side nodes, the north row
 
-	vector<Node> points;
+	MeshPlanes<Real> mesh;
 	vector<Rectangle> rectangles;
 
+	// Clustered node positions in [0, 1] along xi and eta, and the stretch factors of the control
+	// functions per column and row (empty when not in use). southRise / northRise replace the
+	// 2 * dEta of the wall orthogonality condition by the actual distance to the second row.
+	vector<double> xiNodes, etaNodes;
+	vector<Real> stretchXi, stretchEta;
+	double southRise = 0, northRise = 0;
+
+	SweepState sweep;
+	bool resumed = false;	// the next gaussSeibel continues sweep instead of starting over
+
+	// Row-major node number (as in getPoints and the rectangles) to its index in the mesh planes
+	int at(int n) const { return n / iMax * mesh.stride + n % iMax; }
+
 	void createPoints();
+	void createClustering();
+	void createBoundary();
 	void clusterPoints();
-	void transformXY(float x_W, float x_E);
-
-	float y_S(float x);
-	float y_N(float x);
-
-	void enforceBCs(float dXi, float dEta);
-    Node dx(int i, float dXi, float dEta);
-	Node dy(int i, float dXi, float dEta);
-	float alpha(int i, float dXi, float dEta);
-	float beta(int i, float dXi, float dEta);
-	float gamma(int i, float dXi, float dEta);
-	vector<float> getCoeff(int i, float dXi, float dEta);
-	void enforceICs(float dXi, float dEta, float& maxChange);
+	void transformXY(Real x_W, Real x_E);
+	void interpolateTFI(Real x_W, Real x_E, bool orthogonal);
+	void initialGuess();
+	void warmStart(const GridPoints<Real>& start);
+	void solve();
+
+	void enforceBCs(Real dEta) { enforceBCs(mesh, dEta); }
+	void enforceBCs(MeshPlanes<Real>& planes, Real dEta);
+	template <int Wall> void enforceWall(MeshPlanes<Real>& planes, std::size_t first, std::size_t last, Real dEta);
+	void snapEdges(MeshPlanes<Real>& planes, int j, const WallShape& shape);
+	BasicNode<Real> dx(int k, Real dXi, Real dEta);
+	BasicNode<Real> dy(int k, Real dXi, Real dEta);
+	void enforceICs(Real dXi, Real dEta, Real& maxChange);
+	template <bool Stretched> Real relaxInterior(Real dXi, Real dEta);
+	void enforceICsRedBlack(Real dXi, Real dEta, Real& maxChange, ThreadPool& pool);
+	Real relaxLine(int start, int step, int count, Real dXi, Real dEta, Real omega, vector<Real>& scratch);
+	void enforceICsLineSOR(Real dXi, Real dEta, Real omega, Real& maxChange, ThreadPool& pool);
+	void enforceICsTiled(Real dXi, Real dEta, int sweeps, Real& maxChange);
+	Real relaxRowStretched(int i, int j, int count, Real dXi, Real dEta);
+
+	// Float working set of the mixed-precision solver: the correction, the residual it is driven
+	// by and the stencil coefficients (W/E, S/N, SE/NW) frozen at the last residual evaluation
+	struct CorrectionPlanes {
+		MeshPlanes<float> correction;
+		MeshPlanes<float> residual;
+		vector<float> cW, cS, corner;
+	};
+	Real enforceICsMixed(Real dXi, Real dEta, int sweeps, CorrectionPlanes& planes);
 
 };
 
@@ -0,0 +1,105 @@
+#include "snapshot.h"
+#include <charconv>
+#include <chrono>
+
+SnapshotWriter::SnapshotWriter(std::string filePrefix, int every)
+	: filePrefix(std::move(filePrefix)), every(every) {
+	writer = std::thread(&SnapshotWriter::writeLoop, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	stagedOne.notify_one();
+	writer.join();
+}
+
+SnapshotWriter::Buffer& SnapshotWriter::freeBuffer() {
+	std::unique_lock<std::mutex> lock(mutex);
+	auto free = [&] { return !buffers[0].staged || !buffers[1].staged; };
+	if (!free()) {
+		auto start = std::chrono::steady_clock::now();
+		freedOne.wait(lock, free);
+		stalledCaptures++;
+		stalledSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	// With one buffer staged the other is free; with none, the one after the next write keeps the order
+	if (buffers[nextWrite].staged) return buffers[1 - nextWrite];
+	return buffers[nextWrite];
+}
+
+void SnapshotWriter::stage(Buffer& buffer) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		buffer.staged = true;
+	}
+	stagedOne.notify_one();
+}
+
+void SnapshotWriter::writeLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		stagedOne.wait(lock, [&] { return stopping || buffers[nextWrite].staged; });
+		if (!buffers[nextWrite].staged) return;
+
+		Buffer& buffer = buffers[nextWrite];
+		lock.unlock();
+		write(buffer);
+		lock.lock();
+
+		buffer.staged = false;
+		nextWrite = 1 - nextWrite;
+		freedOne.notify_one();
+	}
+}
+
+void SnapshotWriter::write(const Buffer& buffer) {
+	std::ofstream outFile(filePrefix + std::to_string(buffer.iteration) + ".dat");
+	if (!outFile) {
+		std::lock_guard<std::mutex> lock(mutex);
+		failedFiles++;
+		return;
+	}
+
+	// Formatted as writePointsTecplot does (%g, 6 digits) but without the stream per number, and
+	// written in one go
+	std::string text = "TITLE = \"2D Mesh Data\"\nVARIABLES = \"X\" \"Y\"\nZONE T=\"2D Mesh\", I=" + std::to_string(buffer.iMax)
+		+ ", J=" + std::to_string(buffer.jMax) + ", DATAPACKING=POINT\n";
+	text.reserve(text.size() + buffer.x.size() * 24);
+	char number[32];
+	auto append = [&](double value) {
+		text.append(number, std::to_chars(number, number + sizeof(number), value, std::chars_format::general, 6).ptr);
+	};
+	for (std::size_t n = 0; n < buffer.x.size(); n++) {
+		append(buffer.x[n]);
+		text += ' ';
+		append(buffer.y[n]);
+		text += '\n';
+	}
+	outFile.write(text.data(), text.size());
+	outFile.close();
+	std::lock_guard<std::mutex> lock(mutex);
+	writtenFiles++;
+}
+
+int SnapshotWriter::written() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return writtenFiles;
+}
+
+int SnapshotWriter::failed() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failedFiles;
+}
+
+int SnapshotWriter::stalls() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stalledCaptures;
+}
+
+double SnapshotWriter::stallSeconds() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stalledSeconds;
+}
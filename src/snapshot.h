@@ -0,0 +1,82 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "meshplanes.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Periodic Tecplot dumps of a grid during a solve, e.g. for its convergence history, set through
+// SolverSettings::snapshots. capture copies the points into one of two staging buffers and
+// returns; a background thread writes the buffers out. When both are still taken, i.e. the
+// writer is a full snapshot behind, capture waits for one to free up rather than dropping or
+// queueing without bound.
+class SnapshotWriter {
+public:
+	// Writes filePrefix + iteration + ".dat" every `every` iterations
+	SnapshotWriter(std::string filePrefix, int every);
+	~SnapshotWriter();	// writes what is still staged
+
+	SnapshotWriter(const SnapshotWriter&) = delete;
+	SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+	// Whether a snapshot falls in (previous, iteration]
+	bool due(int previous, int iteration) const { return every > 0 && iteration / every != previous / every; }
+
+	template <typename Real>
+	void capture(const MeshPlanes<Real>& planes, int iteration);
+
+	int written() const;
+	int failed() const;				// files that could not be opened
+	int stalls() const;				// captures that had to wait for the writer
+	double stallSeconds() const;
+
+private:
+	struct Buffer {
+		vector<double> x, y;
+		int iMax = 0, jMax = 0, iteration = 0;
+		bool staged = false;		// waiting for or being written by the writer
+	};
+
+	std::string filePrefix;
+	int every;
+	Buffer buffers[2];
+	int nextWrite = 0;				// buffer the writer takes next, staged in order
+
+	std::thread writer;
+	mutable std::mutex mutex;
+	std::condition_variable stagedOne, freedOne;
+	bool stopping = false;
+	int writtenFiles = 0, failedFiles = 0, stalledCaptures = 0;
+	double stalledSeconds = 0;
+
+	Buffer& freeBuffer();
+	void stage(Buffer& buffer);
+	void write(const Buffer& buffer);
+	void writeLoop();
+};
+
+template <typename Real>
+void SnapshotWriter::capture(const MeshPlanes<Real>& planes, int iteration) {
+	Buffer& buffer = freeBuffer();
+
+	// The writer leaves free buffers alone, so the copy needs no lock
+	buffer.iMax = planes.iMax;
+	buffer.jMax = planes.jMax;
+	buffer.iteration = iteration;
+	buffer.x.resize(std::size_t(planes.iMax) * planes.jMax);
+	buffer.y.resize(buffer.x.size());
+	for (int j = 0; j < planes.jMax; j++) {
+		const Real* x = planes.x() + planes.index(0, j);
+		const Real* y = planes.y() + planes.index(0, j);
+		double* bx = buffer.x.data() + std::size_t(j) * planes.iMax;
+		double* by = buffer.y.data() + std::size_t(j) * planes.iMax;
+		for (int i = 0; i < planes.iMax; i++) {
+			bx[i] = x[i];
+			by[i] = y[i];
+		}
+	}
+	stage(buffer);
+}
+
+#endif // SNAPSHOT_H
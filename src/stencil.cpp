@@ -0,0 +1,186 @@
+#include "stencil.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STENCIL_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+template <typename Real>
+static Real relaxColourRowScalar(Real* x, Real* y, int first, int count, int stride, Real dXi, Real dEta) {
+	Real maxChange = 0;
+	for (int n = 0; n < count; n++) {
+		maxChange = max(maxChange, relaxWinslowNode(x, y, first + 2 * n, stride, dXi, dEta));
+	}
+	return maxChange;
+}
+
+#ifdef STENCIL_X86_KERNELS
+
+// Both kernels evaluate the same expressions as winslowCoeff / relaxWinslowNode, lane by lane.
+// Lanes of the other colour are computed as well but never stored, which keeps every load
+// contiguous; the row padding of MeshPlanes keeps the last east neighbour in bounds.
+
+__attribute__((target("avx2,fma")))
+static float relaxColourRowAVX2(float* x, float* y, int first, int count, int stride, float dXi, float dEta) {
+	const __m256 invDXi2 = _mm256_set1_ps(1.f / (2 * dXi));
+	const __m256 invDEta2 = _mm256_set1_ps(1.f / (2 * dEta));
+	const __m256 twoOverDXiSq = _mm256_set1_ps(2.f / (dXi * dXi));
+	const __m256 twoOverDEtaSq = _mm256_set1_ps(2.f / (dEta * dEta));
+	const __m256 overDXiSq = _mm256_set1_ps(1.f / (dXi * dXi));
+	const __m256 overDEtaSq = _mm256_set1_ps(1.f / (dEta * dEta));
+	const __m256 overCross = _mm256_set1_ps(1.f / (2 * dXi * dEta));
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const int colourLanes = 0x55;
+
+	__m256 maxChange = _mm256_setzero_ps();
+	int n = 0;
+	for (; n + 4 <= count; n += 4) {
+		float* px = x + first + 2 * n;
+		float* py = y + first + 2 * n;
+
+		__m256 xC = _mm256_loadu_ps(px);
+		__m256 yC = _mm256_loadu_ps(py);
+		__m256 xW = _mm256_loadu_ps(px - 1);
+		__m256 yW = _mm256_loadu_ps(py - 1);
+		__m256 xE = _mm256_loadu_ps(px + 1);
+		__m256 yE = _mm256_loadu_ps(py + 1);
+		__m256 xS = _mm256_loadu_ps(px - stride);
+		__m256 yS = _mm256_loadu_ps(py - stride);
+		__m256 xN = _mm256_loadu_ps(px + stride);
+		__m256 yN = _mm256_loadu_ps(py + stride);
+		__m256 xSW = _mm256_loadu_ps(px - stride - 1);
+		__m256 ySW = _mm256_loadu_ps(py - stride - 1);
+		__m256 xSE = _mm256_loadu_ps(px - stride + 1);
+		__m256 ySE = _mm256_loadu_ps(py - stride + 1);
+		__m256 xNW = _mm256_loadu_ps(px + stride - 1);
+		__m256 yNW = _mm256_loadu_ps(py + stride - 1);
+		__m256 xNE = _mm256_loadu_ps(px + stride + 1);
+		__m256 yNE = _mm256_loadu_ps(py + stride + 1);
+
+		__m256 xXi = _mm256_mul_ps(_mm256_sub_ps(xE, xW), invDXi2);
+		__m256 xEta = _mm256_mul_ps(_mm256_sub_ps(xN, xS), invDEta2);
+		__m256 yXi = _mm256_mul_ps(_mm256_sub_ps(yE, yW), invDXi2);
+		__m256 yEta = _mm256_mul_ps(_mm256_sub_ps(yN, yS), invDEta2);
+
+		__m256 a = _mm256_fmadd_ps(xEta, xEta, _mm256_mul_ps(yEta, yEta));
+		__m256 b = _mm256_fmadd_ps(xXi, xEta, _mm256_mul_ps(yXi, yEta)); // negated beta
+		__m256 g = _mm256_fmadd_ps(xXi, xXi, _mm256_mul_ps(yEta, yEta));
+
+		__m256 mult = _mm256_div_ps(one, _mm256_fmadd_ps(a, twoOverDXiSq, _mm256_mul_ps(g, twoOverDEtaSq)));
+		__m256 cW = _mm256_mul_ps(_mm256_mul_ps(mult, a), overDXiSq);
+		__m256 cS = _mm256_mul_ps(_mm256_mul_ps(mult, g), overDEtaSq);
+		__m256 corner = _mm256_mul_ps(_mm256_mul_ps(mult, b), overCross);
+
+		// SW and NE carry -corner, SE and NW +corner; b above is -beta, so the signs swap
+		__m256 crossX = _mm256_sub_ps(_mm256_add_ps(xSW, xNE), _mm256_add_ps(xSE, xNW));
+		__m256 crossY = _mm256_sub_ps(_mm256_add_ps(ySW, yNE), _mm256_add_ps(ySE, yNW));
+		__m256 newX = _mm256_fmadd_ps(cW, _mm256_add_ps(xW, xE), _mm256_fmadd_ps(cS, _mm256_add_ps(xS, xN), _mm256_mul_ps(corner, crossX)));
+		__m256 newY = _mm256_fmadd_ps(cW, _mm256_add_ps(yW, yE), _mm256_fmadd_ps(cS, _mm256_add_ps(yS, yN), _mm256_mul_ps(corner, crossY)));
+
+		__m256 change = _mm256_max_ps(_mm256_and_ps(_mm256_sub_ps(newX, xC), absMask), _mm256_and_ps(_mm256_sub_ps(newY, yC), absMask));
+		maxChange = _mm256_max_ps(maxChange, _mm256_blend_ps(_mm256_setzero_ps(), change, colourLanes));
+
+		_mm256_storeu_ps(px, _mm256_blend_ps(xC, newX, colourLanes));
+		_mm256_storeu_ps(py, _mm256_blend_ps(yC, newY, colourLanes));
+	}
+
+	alignas(32) float lanes[8];
+	_mm256_store_ps(lanes, maxChange);
+	float result = 0.f;
+	for (float lane : lanes) result = max(result, lane);
+
+	return max(result, relaxColourRowScalar(x, y, first + 2 * n, count - n, stride, dXi, dEta));
+}
+
+__attribute__((target("avx512f")))
+static float relaxColourRowAVX512(float* x, float* y, int first, int count, int stride, float dXi, float dEta) {
+	const __m512 invDXi2 = _mm512_set1_ps(1.f / (2 * dXi));
+	const __m512 invDEta2 = _mm512_set1_ps(1.f / (2 * dEta));
+	const __m512 twoOverDXiSq = _mm512_set1_ps(2.f / (dXi * dXi));
+	const __m512 twoOverDEtaSq = _mm512_set1_ps(2.f / (dEta * dEta));
+	const __m512 overDXiSq = _mm512_set1_ps(1.f / (dXi * dXi));
+	const __m512 overDEtaSq = _mm512_set1_ps(1.f / (dEta * dEta));
+	const __m512 overCross = _mm512_set1_ps(1.f / (2 * dXi * dEta));
+	const __m512 one = _mm512_set1_ps(1.f);
+	const __mmask16 colourLanes = 0x5555;
+
+	__m512 maxChange = _mm512_setzero_ps();
+	int n = 0;
+	for (; n + 8 <= count; n += 8) {
+		float* px = x + first + 2 * n;
+		float* py = y + first + 2 * n;
+
+		__m512 xC = _mm512_loadu_ps(px);
+		__m512 yC = _mm512_loadu_ps(py);
+		__m512 xW = _mm512_loadu_ps(px - 1);
+		__m512 yW = _mm512_loadu_ps(py - 1);
+		__m512 xE = _mm512_loadu_ps(px + 1);
+		__m512 yE = _mm512_loadu_ps(py + 1);
+		__m512 xS = _mm512_loadu_ps(px - stride);
+		__m512 yS = _mm512_loadu_ps(py - stride);
+		__m512 xN = _mm512_loadu_ps(px + stride);
+		__m512 yN = _mm512_loadu_ps(py + stride);
+		__m512 xSW = _mm512_loadu_ps(px - stride - 1);
+		__m512 ySW = _mm512_loadu_ps(py - stride - 1);
+		__m512 xSE = _mm512_loadu_ps(px - stride + 1);
+		__m512 ySE = _mm512_loadu_ps(py - stride + 1);
+		__m512 xNW = _mm512_loadu_ps(px + stride - 1);
+		__m512 yNW = _mm512_loadu_ps(py + stride - 1);
+		__m512 xNE = _mm512_loadu_ps(px + stride + 1);
+		__m512 yNE = _mm512_loadu_ps(py + stride + 1);
+
+		__m512 xXi = _mm512_mul_ps(_mm512_sub_ps(xE, xW), invDXi2);
+		__m512 xEta = _mm512_mul_ps(_mm512_sub_ps(xN, xS), invDEta2);
+		__m512 yXi = _mm512_mul_ps(_mm512_sub_ps(yE, yW), invDXi2);
+		__m512 yEta = _mm512_mul_ps(_mm512_sub_ps(yN, yS), invDEta2);
+
+		__m512 a = _mm512_fmadd_ps(xEta, xEta, _mm512_mul_ps(yEta, yEta));
+		__m512 b = _mm512_fmadd_ps(xXi, xEta, _mm512_mul_ps(yXi, yEta)); // negated beta
+		__m512 g = _mm512_fmadd_ps(xXi, xXi, _mm512_mul_ps(yEta, yEta));
+
+		__m512 mult = _mm512_div_ps(one, _mm512_fmadd_ps(a, twoOverDXiSq, _mm512_mul_ps(g, twoOverDEtaSq)));
+		__m512 cW = _mm512_mul_ps(_mm512_mul_ps(mult, a), overDXiSq);
+		__m512 cS = _mm512_mul_ps(_mm512_mul_ps(mult, g), overDEtaSq);
+		__m512 corner = _mm512_mul_ps(_mm512_mul_ps(mult, b), overCross);
+
+		__m512 crossX = _mm512_sub_ps(_mm512_add_ps(xSW, xNE), _mm512_add_ps(xSE, xNW));
+		__m512 crossY = _mm512_sub_ps(_mm512_add_ps(ySW, yNE), _mm512_add_ps(ySE, yNW));
+		__m512 newX = _mm512_fmadd_ps(cW, _mm512_add_ps(xW, xE), _mm512_fmadd_ps(cS, _mm512_add_ps(xS, xN), _mm512_mul_ps(corner, crossX)));
+		__m512 newY = _mm512_fmadd_ps(cW, _mm512_add_ps(yW, yE), _mm512_fmadd_ps(cS, _mm512_add_ps(yS, yN), _mm512_mul_ps(corner, crossY)));
+
+		__m512 change = _mm512_max_ps(_mm512_abs_ps(_mm512_sub_ps(newX, xC)), _mm512_abs_ps(_mm512_sub_ps(newY, yC)));
+		maxChange = _mm512_mask_max_ps(maxChange, colourLanes, maxChange, change);
+
+		_mm512_mask_storeu_ps(px, colourLanes, newX);
+		_mm512_mask_storeu_ps(py, colourLanes, newY);
+	}
+
+	float result = _mm512_reduce_max_ps(maxChange);
+	return max(result, relaxColourRowScalar(x, y, first + 2 * n, count - n, stride, dXi, dEta));
+}
+
+#endif // STENCIL_X86_KERNELS
+
+SimdLevel detectSimdLevel() {
+#ifdef STENCIL_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+#endif
+	return SimdLevel::Scalar;
+}
+
+template <>
+ColourRowKernel<float> colourRowKernel<float>(SimdLevel level) {
+#ifdef STENCIL_X86_KERNELS
+	if (level == SimdLevel::AVX512) return relaxColourRowAVX512;
+	if (level == SimdLevel::AVX2) return relaxColourRowAVX2;
+#endif
+	return relaxColourRowScalar<float>;
+}
+
+template <>
+ColourRowKernel<double> colourRowKernel<double>(SimdLevel) {
+	return relaxColourRowScalar<double>;
+}
@@ -0,0 +1,81 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include "geometry.h"
+
+// Coefficients of the 9-point stencil of the elliptic grid equations at one node,
+// ordered SW, S, SE, W, E, NW, N, NE. dX = (x_xi, x_eta) and dY = (y_xi, y_eta) are the
+// central-difference metrics at the node. Returns the normalisation factor the coefficients
+// are scaled by, i.e. the reciprocal of the diagonal of the unscaled operator.
+// stretchXi / stretchEta add the control functions of a clustered grid, see stretchFactors.
+template <typename Real>
+inline Real winslowCoeff(BasicNode<Real> dX, BasicNode<Real> dY, Real dXi, Real dEta, Real coeff[8],
+	Real stretchXi = 0, Real stretchEta = 0) {
+	Real a = dX.y * dX.y + dY.y * dY.y;
+	Real b = -(dX.x * dX.y + dY.x * dY.y);
+	Real g = dX.x * dX.x + dY.y * dY.y;
+
+	Real mult = 1 / (2 * (a / (dXi * dXi)) + 2 * (g / (dEta * dEta)));
+	Real corner = (mult * b) / (2 * dXi * dEta);
+	coeff[0] = -corner;
+	coeff[1] = (mult * g) / (dEta * dEta);
+	coeff[2] = corner;
+	coeff[3] = (mult * a) / (dXi * dXi);
+	coeff[4] = coeff[3];
+	coeff[5] = corner;
+	coeff[6] = coeff[1];
+	coeff[7] = -corner;
+	if (stretchXi != 0 || stretchEta != 0) {
+		coeff[1] *= 1 - stretchEta;
+		coeff[3] *= 1 - stretchXi;
+		coeff[4] *= 1 + stretchXi;
+		coeff[6] *= 1 + stretchEta;
+	}
+	return mult;
+}
+
+// Gauss-Seidel update of interior node k of x/y planes whose rows are stride values apart.
+// Returns the max coordinate change.
+template <typename Real>
+inline Real relaxWinslowNode(Real* x, Real* y, int k, int stride, Real dXi, Real dEta, Real stretchXi = 0, Real stretchEta = 0) {
+	BasicNode<Real> dX = { (x[k + 1] - x[k - 1]) / (2 * dXi), (x[k + stride] - x[k - stride]) / (2 * dEta) };
+	BasicNode<Real> dY = { (y[k + 1] - y[k - 1]) / (2 * dXi), (y[k + stride] - y[k - stride]) / (2 * dEta) };
+
+	Real coeff[8];
+	winslowCoeff(dX, dY, dXi, dEta, coeff, stretchXi, stretchEta);
+
+	Real newX = coeff[0] * x[k - 1 - stride] + coeff[1] * x[k - stride] + coeff[2] * x[k + 1 - stride] + coeff[3] * x[k - 1]
+				+ coeff[4] * x[k + 1] + coeff[5] * x[k - 1 + stride] + coeff[6] * x[k + stride] + coeff[7] * x[k + 1 + stride];
+	Real newY = coeff[0] * y[k - 1 - stride] + coeff[1] * y[k - stride] + coeff[2] * y[k + 1 - stride] + coeff[3] * y[k - 1]
+				+ coeff[4] * y[k + 1] + coeff[5] * y[k - 1 + stride] + coeff[6] * y[k + stride] + coeff[7] * y[k + 1 + stride];
+
+	Real change = std::max(std::fabs(newX - x[k]), std::fabs(newY - y[k]));
+	x[k] = newX;
+	y[k] = newY;
+	return change;
+}
+
+enum class SimdLevel {
+	Scalar,
+	AVX2,
+	AVX512
+};
+
+// Relaxes count nodes of one row of a colour, i.e. first, first + 2, ..., with relaxWinslowNode.
+// Nodes of one colour do not depend on each other, so the vector kernels evaluate 8 (AVX2) or
+// 16 (AVX-512) contiguous nodes at once and only commit the lanes of the colour being relaxed.
+// Relies on the MeshPlanes row padding. Returns the max coordinate change. Only float has vector
+// kernels, double always gets the scalar one.
+template <typename Real>
+using ColourRowKernel = Real (*)(Real* x, Real* y, int first, int count, int stride, Real dXi, Real dEta);
+
+SimdLevel detectSimdLevel();
+
+template <typename Real>
+ColourRowKernel<Real> colourRowKernel(SimdLevel level);
+template <>
+ColourRowKernel<float> colourRowKernel<float>(SimdLevel level);
+template <>
+ColourRowKernel<double> colourRowKernel<double>(SimdLevel level);
+
+#endif // STENCIL_H
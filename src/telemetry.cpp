@@ -0,0 +1,83 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <iostream>
+
+Telemetry::Telemetry(double interval, Callback callback)
+	: interval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval))), callback(std::move(callback)) {
+	drainInterval = std::max<Clock::duration>(this->interval, minDrainInterval);
+	start = next = Clock::now();
+	if (this->callback) {
+		drainer = std::thread(&Telemetry::drainLoop, this);
+	}
+}
+
+Telemetry::~Telemetry() {
+	if (drainer.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		drainer.join();
+	}
+}
+
+void Telemetry::begin(const char* solver) {
+	this->solver = solver;
+	start = Clock::now();
+	next = start;
+	lastPushed = -1;
+}
+
+void Telemetry::end(int iteration, double residual, const MeshQuality* quality) {
+	if (iteration != lastPushed || quality) push(Clock::now(), iteration, residual, capacity, quality);
+	// Unlocked, so the solver does not wait for the drainer; at worst the sample goes out one
+	// interval later
+	wake.notify_one();
+}
+
+void Telemetry::push(Clock::time_point now, int iteration, double residual, std::size_t limit, const MeshQuality* quality) {
+	std::size_t slot = head.load(std::memory_order_relaxed);
+	if (slot - tail.load(std::memory_order_acquire) >= limit) {
+		droppedSamples.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring[slot % capacity] = { solver, iteration, residual, std::chrono::duration<double>(now - start).count(),
+		quality != nullptr, quality ? *quality : MeshQuality() };
+	head.store(slot + 1, std::memory_order_release);
+	lastPushed = iteration;
+}
+
+bool Telemetry::poll(ProgressSample& sample) {
+	std::size_t slot = tail.load(std::memory_order_relaxed);
+	if (slot == head.load(std::memory_order_acquire)) return false;
+	sample = ring[slot % capacity];
+	tail.store(slot + 1, std::memory_order_release);
+	return true;
+}
+
+void Telemetry::drain() {
+	ProgressSample sample;
+	while (poll(sample)) callback(sample);
+}
+
+void Telemetry::drainLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping) {
+		wake.wait_for(lock, drainInterval);
+		lock.unlock();
+		drain();
+		lock.lock();
+	}
+	lock.unlock();
+	drain();
+}
+
+void Telemetry::printSample(const ProgressSample& sample) {
+	std::cout << sample.solver << " " << sample.iteration << ": " << sample.residual << " (" << sample.elapsed << " s)";
+	if (sample.qualityStop) {
+		std::cout << ", quality targets met: skewness " << sample.quality.maxSkewness << ", aspect ratio "
+			<< sample.quality.maxAspectRatio << ", wall deviation " << sample.quality.maxWallDeviation;
+	}
+	std::cout << "\n";
+}
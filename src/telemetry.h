@@ -0,0 +1,88 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "quality.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Progress of a solve at one point in time
+struct ProgressSample {
+	const char* solver = "";	// name passed to Telemetry::begin
+	int iteration = 0;			// sweeps, cycles or Newton steps, as the solver counts them
+	double residual = 0;		// the solver's convergence measure, e.g. the max change of a sweep
+	double elapsed = 0;			// seconds since begin
+	bool qualityStop = false;	// last sample of a solve stopped on its quality targets
+	MeshQuality quality;		// the quality met, with qualityStop
+};
+
+// Opt-in progress reporting for the solvers, set through SolverSettings::telemetry. The solver
+// thread only reads the clock and, at most once per interval of wall time, writes a sample into
+// a lock-free single-producer ring; it never takes a lock or waits on output. With a callback
+// a background thread drains the ring, otherwise the caller samples it with poll. The last
+// sample of a solve is always posted. One solve at a time may post to a Telemetry.
+class Telemetry {
+public:
+	using Callback = std::function<void(const ProgressSample&)>;
+
+	// interval 0 posts every iteration; the drainer still waits at least minDrainInterval between drains
+	explicit Telemetry(double interval = 1.0, Callback callback = printSample);
+	~Telemetry();
+
+	Telemetry(const Telemetry&) = delete;
+	Telemetry& operator=(const Telemetry&) = delete;
+
+	// Solver side
+	void begin(const char* solver);
+	void post(int iteration, double residual) {
+		Clock::time_point now = Clock::now();
+		if (now < next) return;
+		next = now + interval;
+		push(now, iteration, residual, capacity / 2);
+	}
+	// quality when the solve stopped because the grid met its quality targets
+	void end(int iteration, double residual, const MeshQuality* quality = nullptr);
+
+	// Caller side when there is no callback: takes the oldest sample not yet seen
+	bool poll(ProgressSample& sample);
+
+	// Samples lost because the ring was full when the solver posted them
+	unsigned long dropped() const { return droppedSamples.load(std::memory_order_relaxed); }
+
+	// "<solver> <iteration>: <residual> (<elapsed> s)" on cout, without flushing, followed by the
+	// quality of a quality stop
+	static void printSample(const ProgressSample& sample);
+
+private:
+	using Clock = std::chrono::steady_clock;
+	static constexpr std::size_t capacity = 256;
+	static constexpr std::chrono::milliseconds minDrainInterval{ 1 };
+
+	Clock::duration interval, drainInterval;
+	Callback callback;
+
+	// Written by the solver thread only
+	const char* solver = "";
+	Clock::time_point start, next;
+	int lastPushed = -1;	// iteration of the last sample that went into the ring
+
+	std::array<ProgressSample, capacity> ring;
+	std::atomic<std::size_t> head{ 0 }, tail{ 0 };	// next slot to write / to read
+	std::atomic<unsigned long> droppedSamples{ 0 };
+
+	std::thread drainer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	// Leaves the ring alone once it holds limit samples; post keeps half of it for end
+	void push(Clock::time_point now, int iteration, double residual, std::size_t limit, const MeshQuality* quality = nullptr);
+	void drain();
+	void drainLoop();
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,73 @@
+#include "threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads) : numThreads(numThreads) {
+	if (this->numThreads <= 0) {
+		this->numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+	for (int t = 1; t < this->numThreads; t++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, t);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::runChunk(int index) {
+	long long length = taskEnd - taskBegin;
+	int chunkBegin = taskBegin + static_cast<int>(length * index / numThreads);
+	int chunkEnd = taskBegin + static_cast<int>(length * (index + 1) / numThreads);
+	if (chunkBegin < chunkEnd) {
+		(*task)(chunkBegin, chunkEnd, index);
+	}
+}
+
+void ThreadPool::workerLoop(int index) {
+	unsigned long seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+
+		runChunk(index);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--pending == 0) done.notify_one();
+	}
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int, int)>& body) {
+	if (end <= begin) return;
+	if (numThreads == 1) {
+		body(begin, end, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &body;
+		taskBegin = begin;
+		taskEnd = end;
+		pending = numThreads - 1;
+		generation++;
+	}
+	wake.notify_all();
+
+	// The calling thread takes chunk 0
+	runChunk(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return pending == 0; });
+	task = nullptr;
+}
@@ -0,0 +1,43 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool {
+public:
+	// numThreads <= 0 uses every hardware thread; the calling thread counts as one of them
+	explicit ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	int size() const { return numThreads; }
+
+	// Splits [begin, end) into one contiguous chunk per thread and blocks until every chunk is done.
+	// body(chunkBegin, chunkEnd, threadIndex)
+	void parallelFor(int begin, int end, const std::function<void(int, int, int)>& body);
+
+private:
+	int numThreads;
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(int, int, int)>* task = nullptr;
+	int taskBegin = 0, taskEnd = 0;
+	unsigned long generation = 0;
+	int pending = 0;
+	bool stopping = false;
+
+	void workerLoop(int index);
+	void runChunk(int index);
+};
+
+#endif // THREADPOOL_H
@@ -1,9 +1,109 @@
 #include "triangular.h"
+#include "predicates.h"
+#include "threadpool.h"
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+// Clouds smaller than this are sorted on the calling thread
+const int parallelSortPoints = 1 << 16;
+
+// Brio: the first round holds at least this many points, then each round doubles
+const int brioFirstRound = 64;
+const int brioMaxRounds = 16;
+
+// Random bits of point i, the same whichever thread draws them (splitmix64)
+uint64_t pointHash(unsigned seed, int i) {
+    uint64_t z = (uint64_t(seed) << 32) + uint64_t(i) + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void forChunks(ThreadPool* pool, int count, const std::function<void(int, int, int)>& body) {
+    if (pool) pool->parallelFor(0, count, body);
+    else body(0, count, 0);
+}
+
+// Position along the Hilbert curve of the cell holding (x, y) in [0, 1] x [0, 1], on a lattice of
+// 2^bits x 2^bits cells, bits <= 16
+uint32_t hilbertKey(float x, float y, int bits) {
+    const uint32_t side = 1u << bits;
+    uint32_t qx = min(static_cast<uint32_t>(max(x, 0.f) * side), side - 1);
+    uint32_t qy = min(static_cast<uint32_t>(max(y, 0.f) * side), side - 1);
+    uint32_t key = 0;
+    for (uint32_t s = side / 2; s > 0; s /= 2) {
+        uint32_t rx = (qx & s) ? 1 : 0;
+        uint32_t ry = (qy & s) ? 1 : 0;
+        key += s * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant so the curve enters it at its origin: mirror when rx = 1, ry = 0,
+        // then swap x and y when ry = 0. Branch free, the quadrants are unpredictable.
+        uint32_t mirror = (0u - (rx & (ry ^ 1))) & (side - 1);
+        qx ^= mirror;
+        qy ^= mirror;
+        uint32_t swapped = (qx ^ qy) & (0u - (ry ^ 1));
+        qx ^= swapped;
+        qy ^= swapped;
+    }
+    return key;
+}
+
+// Positive when p is right of the edge from points[a] to points[b], outside of a counterclockwise
+// triangle. The sign is exact, so the two triangles sharing an edge always agree on it.
+double sideOfEdge(const vector<Node>& points, int a, int b, const Node& p) {
+    return orient2d(points[b], points[a], p);
+}
+
+// Stable LSD radix sort of the points by key, 11 bits a pass and only as many passes as maxKey
+// needs. Every thread counts and scatters its own contiguous chunk, which keeps the sort stable.
+void radixSort(vector<Node>& points, vector<uint32_t>& keys, uint32_t maxKey, ThreadPool* pool) {
+    const int digitBits = 11, buckets = 1 << digitBits;
+    int numPoints = points.size();
+    int threads = pool ? pool->size() : 1;
+    vector<Node> sortedPoints(numPoints);
+    vector<uint32_t> sortedKeys(numPoints);
+    vector<int> offsets(threads * buckets);
+
+    for (int shift = 0; shift < 32 && (maxKey >> shift) > 0; shift += digitBits) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        forChunks(pool, numPoints, [&](int begin, int end, int t) {
+            int* count = &offsets[t * buckets];
+            for (int i = begin; i < end; i++) count[(keys[i] >> shift) & (buckets - 1)]++;
+        });
+
+        // Start of every digit in every chunk: digits in order, chunks in order within a digit
+        int start = 0;
+        for (int d = 0; d < buckets; d++) {
+            for (int t = 0; t < threads; t++) {
+                int count = offsets[t * buckets + d];
+                offsets[t * buckets + d] = start;
+                start += count;
+            }
+        }
+
+        forChunks(pool, numPoints, [&](int begin, int end, int t) {
+            int* next = &offsets[t * buckets];
+            for (int i = begin; i < end; i++) {
+                int slot = next[(keys[i] >> shift) & (buckets - 1)]++;
+                sortedPoints[slot] = points[i];
+                sortedKeys[slot] = keys[i];
+            }
+        });
+        points.swap(sortedPoints);
+        keys.swap(sortedKeys);
+    }
+}
+
+}
 
 void Triangular::normalizePoints(float& xmin, float& ymin, float& dmax) {
     int numPoints = points.size();
     // Find min and max boundaries of point cloud
-    float xmax = 0, ymax = 0;
+    xmin = numPoints ? points[0].x : 0.f;
+    ymin = numPoints ? points[0].y : 0.f;
+    float xmax = xmin, ymax = ymin;
     for (int i = 0; i < numPoints; i++) {
         xmax = max(xmax, points[i].x);
         xmin = min(xmin, points[i].x);
@@ -13,6 +113,9 @@ void Triangular::normalizePoints(float& xmin, float& ymin, float& dmax) {
 
     // Remap everything (preserving the aspect ratio) to between (0,0) - (1,1)
     dmax = max(xmax - xmin, ymax - ymin); // dmax = largest dimension
+    if (!std::isfinite(dmax)) throw std::runtime_error("Extent of the points is not finite");
+    // Points all in one place stay there, at the origin
+    if (dmax == 0) dmax = 1;
     for (int i = 0; i < numPoints; i++) {
         points[i].x = (points[i].x - xmin) / dmax;
         points[i].y = (points[i].y - ymin) / dmax;
@@ -27,37 +130,60 @@ void Triangular::denormalizePoints(float& xmin, float& ymin, float& dmax) {
     }
 }
 
-void Triangular::binSort() {
+void Triangular::sortPoints() {
     // Sort points by proximity
-    int NbinRows = static_cast<int>(std::ceil(std::pow(points.size(), 0.25)));
-    vector<int> bins(points.size());
-    for (int i = 0; i < points.size(); i++) {
-        int p = static_cast<int>(points[i].y * NbinRows * 0.999); // bin row
-        int q = static_cast<int>(points[i].x * NbinRows * 0.999); // bin column
-        if (p % 2)
-            bins[i] = (p + 1) * NbinRows - q;
-        else
-            bins[i] = p * NbinRows + q + 1;
-    }
-
-    // Insertion sort
-    for (int i = 1; i < points.size(); i++) {
-        int key = bins[i];
-        Node tempF = points[i];
-        int j = i - 1;
-        while (j >= 0 && (bins[j] > key)) {
-            bins[j + 1] = bins[j];
-            points[j + 1] = points[j];
-            j--;
+    int numPoints = points.size();
+    std::unique_ptr<ThreadPool> pool;
+    if (numPoints >= parallelSortPoints && settings.numThreads != 1) {
+        pool = std::make_unique<ThreadPool>(settings.numThreads);
+    }
+
+    vector<uint32_t> keys(numPoints);
+    uint32_t maxKey;
+    if (settings.order == PointOrder::Hilbert || settings.order == PointOrder::Brio) {
+        // Brio: the last round takes each point with probability 1/2, the one before with 1/4 and
+        // so on, the first round the rest. The round goes above the Hilbert key, in 4 bits.
+        int rounds = 1;
+        if (settings.order == PointOrder::Brio) {
+            while (rounds < brioMaxRounds && (numPoints >> rounds) >= brioFirstRound) rounds++;
         }
-        bins[j + 1] = key;
-        points[j + 1] = tempF;
+
+        // About one point per cell, a finer lattice hardly changes the order
+        int maxBits = settings.order == PointOrder::Brio ? 14 : 16;
+        int bits = 1;
+        while (bits < maxBits && (1ll << (2 * bits)) < numPoints) bits++;
+        maxKey = static_cast<uint32_t>((uint64_t(rounds) << (2 * bits)) - 1);
+        forChunks(pool.get(), numPoints, [&](int begin, int end, int) {
+            for (int i = begin; i < end; i++) {
+                uint64_t coins = pointHash(settings.seed, i);
+                int level = 0;
+                while (level < rounds - 1 && !((coins >> level) & 1)) level++;
+                uint64_t round = rounds - 1 - level;
+                keys[i] = static_cast<uint32_t>(round << (2 * bits)) | hilbertKey(points[i].x, points[i].y, bits);
+            }
+        });
+    }
+    else {
+        int NbinRows = static_cast<int>(std::ceil(std::pow(points.size(), 0.25)));
+        maxKey = NbinRows * NbinRows;
+        forChunks(pool.get(), numPoints, [&](int begin, int end, int) {
+            for (int i = begin; i < end; i++) {
+                int p = static_cast<int>(points[i].y * NbinRows * 0.999); // bin row
+                int q = static_cast<int>(points[i].x * NbinRows * 0.999); // bin column
+                if (p % 2)
+                    keys[i] = (p + 1) * NbinRows - q;
+                else
+                    keys[i] = p * NbinRows + q + 1;
+            }
+        });
     }
+
+    radixSort(points, keys, maxKey, pool.get());
 }
 
 int Triangular::edge(int L, int K) {
     for (int m = 0; m < 3; m++){
-        if (triangles[L].edges[m] == K) {
+        if (triEdges[L][m] == K) {
             return m;
         }
     }
@@ -65,107 +191,85 @@ int Triangular::edge(int L, int K) {
 }
 
 bool Triangular::delanayCondition(Node P, Node v1, Node v2, Node v3) {
-    float cosa = (v1 - v3).dot(v2 - v3);
-    float cosb = (v2 - P).dot(v1 - P);
-    if (cosa >= 0.0 && cosb >= 0.0) return false;
-    else if (cosa < 0.0 && cosb < 0.0) return true;
-    else {
-        float sina = (v1 - v3).cross(v2 - v3);;
-        float sinb = (v2 - P).cross(v1 - P);
-        if (sina * cosb + sinb * cosa < 0.0) return true;
-        else return false;
-    }
+    // Swap when v3 lies strictly inside the circle through the counterclockwise P, v2, v1. Points
+    // on the circle keep the diagonal, so the flips of an insertion always come to an end.
+    return incircle(P, v2, v1, v3) > 0;
 }
 
-bool Triangular::pointWithinTriangle(float S1, float S2, float S3) {
-    if ((S1 < 0 && S2 < 0 && S3 < 0) ||
-        (S1 < 1E-10 && S2 < 0 && S3 < 0) ||
-        (S2 < 1E-10 && S1 < 0 && S3 < 0) ||
-        (S3 < 1E-10 && S1 < 0 && S2 < 0)) { // inside triangle
-        return true;
-    }
-    else {
-        return false;
-    }
+bool Triangular::pointWithinTriangle(double S1, double S2, double S3) {
+    // Points on an edge count as inside, the flips then remove the flat triangle
+    return S1 <= 0 && S2 <= 0 && S3 <= 0;
 }
 
 int Triangular::searchForTriangle(int i, int j) {
-    float S1, S2, S3;
+    double S1, S2, S3;
+    int steps = 0;
     do {
+        // A walk on a valid triangulation never comes back to a triangle
+        if (++steps > static_cast<int>(triVertices.size())) {
+            throw std::runtime_error("Point location does not terminate, a point is not finite");
+        }
         // Vertices of a given triangle
-        int V1 = triangles[j].vertices[0];
-        int V2 = triangles[j].vertices[1];
-        int V3 = triangles[j].vertices[2];
-
-        // Vectors of the edges
-        Node AB = points[V2] - points[V1];
-        Node BC = points[V3] - points[V2];
-        Node CA = points[V1] - points[V3];
+        int V1 = triVertices[j][0];
+        int V2 = triVertices[j][1];
+        int V3 = triVertices[j][2];
 
-        Node AP = points[i] - points[V1];
-        Node BP = points[i] - points[V2];
-        Node CP = points[i] - points[V3];
-
-        // Normals of the edges
-        Node N1 = { AB.y, -AB.x };
-        Node N2 = { BC.y, -BC.x };
-        Node N3 = { CA.y, -CA.x };
-
-        S1 = AP.dot(N1);
-        S2 = BP.dot(N2);
-        S3 = CP.dot(N3);
+        // Side of the edges the point lies on
+        S1 = sideOfEdge(points, V1, V2, points[i]);
+        S2 = sideOfEdge(points, V2, V3, points[i]);
+        S3 = sideOfEdge(points, V3, V1, points[i]);
 
         // Adjust j in the direction of target point ii
         if ((S1 > 0) && (S1 >= S2) && (S1 >= S3)) {
-            j = triangles[j].edges[0];
+            j = triEdges[j][0];
         }
         else if ((S2 > 0) && (S2 >= S1) && (S2 >= S3)) {
-            j = triangles[j].edges[1];
+            j = triEdges[j][1];
         }
         else if ((S3 > 0) && (S3 >= S1) && (S3 >= S2)) {
-            j = triangles[j].edges[2];
+            j = triEdges[j][2];
         }
     } while (!pointWithinTriangle(S1, S2, S3));
+    insertionWalks.add(steps);
     return j;
 }
 
 void Triangular::createNewTriangles(int ntri, int T, int i, int& triOnStack, vector<int>& triStack) {
     // Delete triangle T and replace it with three sub-triangles touching P
-    triangles.resize(ntri);
     // Vertices of new triangles
-    triangles[ntri - 2].vertices = { i, triangles[T].vertices[1], triangles[T].vertices[2] };
-    triangles[ntri - 1].vertices = { i, triangles[T].vertices[2], triangles[T].vertices[0] };
+    triVertices[ntri - 2] = { i, triVertices[T][1], triVertices[T][2] };
+    triVertices[ntri - 1] = { i, triVertices[T][2], triVertices[T][0] };
     // Update adjacencies of triangles surrounding the old triangle
-    int A = triangles[T].edges[0];
-    int B = triangles[T].edges[1];
-    int C = triangles[T].edges[2];
-    if (A >= 0) triangles[A].edges[edge(A, T)] = T;
-    if (B >= 0) triangles[B].edges[edge(B, T)] = ntri - 2;
-    if (C >= 0) triangles[C].edges[edge(C, T)] = ntri - 1;
+    int A = triEdges[T][0];
+    int B = triEdges[T][1];
+    int C = triEdges[T][2];
+    if (A >= 0) triEdges[A][edge(A, T)] = T;
+    if (B >= 0) triEdges[B][edge(B, T)] = ntri - 2;
+    if (C >= 0) triEdges[C][edge(C, T)] = ntri - 1;
     // Adjacencies of new triangles    
-    triangles[ntri - 2].edges = { T, triangles[T].edges[1], ntri - 1 };
-    triangles[ntri - 1].edges = { ntri - 2, triangles[T].edges[2], T };
+    triEdges[ntri - 2] = { T, triEdges[T][1], ntri - 1 };
+    triEdges[ntri - 1] = { ntri - 2, triEdges[T][2], T };
     // Replace v3 of containing triangle with P and rotate to v1
-    triangles[T].vertices = { i, triangles[T].vertices[0], triangles[T].vertices[1] };
+    triVertices[T] = { i, triVertices[T][0], triVertices[T][1] };
     // Replace 1st and 3rd adjacencies of containing triangle with new triangles
-    triangles[T].edges = { ntri - 1, triangles[T].edges[0], ntri - 2 };
+    triEdges[T] = { ntri - 1, triEdges[T][0], ntri - 2 };
     // Place each triangle containing P onto a stack, if the edge opposite P has an adjacent triangle
-    if (triangles[T].edges[1] >= 0) triStack[++triOnStack] = T;
-    if (triangles[ntri - 2].edges[1] >= 0) triStack[++triOnStack] = ntri - 2;
-    if (triangles[ntri - 1].edges[1] >= 0) triStack[++triOnStack] = ntri - 1;
+    if (triEdges[T][1] >= 0) triStack[++triOnStack] = T;
+    if (triEdges[ntri - 2][1] >= 0) triStack[++triOnStack] = ntri - 2;
+    if (triEdges[ntri - 1][1] >= 0) triStack[++triOnStack] = ntri - 1;
 }
 
 void Triangular::emptyStack(int& tos, int i, vector<int>& triStack) {
     while (tos >= 0) { // looping thru the stack
         int L = triStack[tos--];
-        Node v1 = points[triangles[L].vertices[2]];
-        Node v2 = points[triangles[L].vertices[1]];
+        Node v1 = points[triVertices[L][2]];
+        Node v2 = points[triVertices[L][1]];
         int oppVert = -1;
         int oppVertID = -1;
         for (int k = 0; k < 3; k++) {
-            if ((triangles[triangles[L].edges[1]].vertices[k] != triangles[L].vertices[1])
-                && (triangles[triangles[L].edges[1]].vertices[k] != triangles[L].vertices[2])) {
-                oppVert = triangles[triangles[L].edges[1]].vertices[k];
+            if ((triVertices[triEdges[L][1]][k] != triVertices[L][1])
+                && (triVertices[triEdges[L][1]][k] != triVertices[L][2])) {
+                oppVert = triVertices[triEdges[L][1]][k];
                 oppVertID = k;
                 break;
             }
@@ -176,36 +280,36 @@ void Triangular::emptyStack(int& tos, int i, vector<int>& triStack) {
         if (delanayCondition(P, v1, v2, v3)) {
             // Swap diagonal, and redo triangles L, R, A, C
             // Initial state:
-            int R = triangles[L].edges[1];
-            int C = triangles[L].edges[2];
-            int A = triangles[R].edges[(oppVertID + 2) % 3];
+            int R = triEdges[L][1];
+            int C = triEdges[L][2];
+            int A = triEdges[R][(oppVertID + 2) % 3];
             // Fix adjacency of A
-            if (A >= 0) triangles[A].edges[edge(A, R)] = L;
+            if (A >= 0) triEdges[A][edge(A, R)] = L;
             // Fix adjacency of C
-            if (C >= 0) triangles[C].edges[edge(C, L)] = R;
+            if (C >= 0) triEdges[C][edge(C, L)] = R;
             // Fix vertices and adjacency of R
             for (int m = 0; m < 3; m++) {
-                if (triangles[R].vertices[m] == oppVert) {
-                    triangles[R].vertices[(m + 2) % 3] = i;
+                if (triVertices[R][m] == oppVert) {
+                    triVertices[R][(m + 2) % 3] = i;
                     break;
                 }
             }
-            triangles[R].edges[edge(R, L)] = C;
-            triangles[R].edges[edge(R, A)] = L;
+            triEdges[R][edge(R, L)] = C;
+            triEdges[R][edge(R, A)] = L;
             for (int m = 0; m < 3; m++) {
-                if (triangles[R].vertices[0] != i) {
-                    triangles[R].vertices = { triangles[R].vertices[1], triangles[R].vertices[2], triangles[R].vertices[0] };
-                    triangles[R].edges = { triangles[R].edges[1], triangles[R].edges[2], triangles[R].edges[0] };
+                if (triVertices[R][0] != i) {
+                    triVertices[R] = { triVertices[R][1], triVertices[R][2], triVertices[R][0] };
+                    triEdges[R] = { triEdges[R][1], triEdges[R][2], triEdges[R][0] };
                 }
             }
 
             // Fix vertices and adjacency of L
-            triangles[L].vertices[2] = oppVert;
-            triangles[L].edges[edge(L, C)] = R;
-            triangles[L].edges[edge(L, R)] = A;
+            triVertices[L][2] = oppVert;
+            triEdges[L][edge(L, C)] = R;
+            triEdges[L][edge(L, R)] = A;
             // Add L and R to stack if they have triangles opposite P;
-            if (triangles[L].edges[1] >= 0) triStack[++tos] = L;
-            if (triangles[R].edges[1] >= 0) triStack[++tos] = R;
+            if (triEdges[L][1] >= 0) triStack[++tos] = L;
+            if (triEdges[R][1] >= 0) triStack[++tos] = R;
         }
     }
 }
@@ -217,7 +321,7 @@ void Triangular::removeSuperTriangle(int& ntri) {
     vector<int> renumberAdj(ntri);
     vector<bool> removeEdge(ntri, false);
     for (int i = 0; i < ntri; i++)
-        if ((triangles[i].vertices[0] >= numPoints - 3) || (triangles[i].vertices[1] >= numPoints - 3) || (triangles[i].vertices[2] >= numPoints - 3)) {
+        if ((triVertices[i][0] >= numPoints - 3) || (triVertices[i][1] >= numPoints - 3) || (triVertices[i][2] >= numPoints - 3)) {
             removeEdge[i] = true;
             renumberAdj[i] = ntri - (nT_final--);
         }
@@ -229,12 +333,12 @@ void Triangular::removeSuperTriangle(int& ntri) {
     vector<Triangle> trianglesFinal(nT_final);
     int index = 0;
     for (int i = 0; i < ntri; i++)
-        if ((triangles[i].vertices[0] < numPoints - 3) && (triangles[i].vertices[1] < numPoints - 3) && (triangles[i].vertices[2] < numPoints - 3)) {
-            trianglesFinal[index].vertices = triangles[i].vertices;
+        if ((triVertices[i][0] < numPoints - 3) && (triVertices[i][1] < numPoints - 3) && (triVertices[i][2] < numPoints - 3)) {
+            trianglesFinal[index].vertices = triVertices[i];
             trianglesFinal[index].edges = {
-                (1 - removeEdge[triangles[i].edges[0]]) * triangles[i].edges[0] - removeEdge[triangles[i].edges[0]],
-                (1 - removeEdge[triangles[i].edges[1]]) * triangles[i].edges[1] - removeEdge[triangles[i].edges[1]],
-                (1 - removeEdge[triangles[i].edges[2]]) * triangles[i].edges[2] - removeEdge[triangles[i].edges[2]]
+                (1 - removeEdge[triEdges[i][0]]) * triEdges[i][0] - removeEdge[triEdges[i][0]],
+                (1 - removeEdge[triEdges[i][1]]) * triEdges[i][1] - removeEdge[triEdges[i][1]],
+                (1 - removeEdge[triEdges[i][2]]) * triEdges[i][2] - removeEdge[triEdges[i][2]]
             };
             index++;
         }
@@ -245,8 +349,142 @@ void Triangular::removeSuperTriangle(int& ntri) {
     }
 
     points.erase(points.end() - 3, points.end());
-    triangles = trianglesFinal;
+    triangles = std::move(trianglesFinal);
     ntri = nT_final;
+
+    // Release the pool
+    triVertices.clear();
+    triVertices.shrink_to_fit();
+    triEdges.clear();
+    triEdges.shrink_to_fit();
+}
+
+void Triangular::removeUnusedPoints(const vector<bool>& unused) {
+    vector<int> renumber(points.size());
+    int kept = 0;
+    for (int i = 0; i < static_cast<int>(points.size()); i++) {
+        renumber[i] = kept;
+        if (!unused[i]) points[kept++] = points[i];
+    }
+    points.resize(kept);
+    for (Triangle& t : triangles) {
+        for (int& v : t.vertices) v = renumber[v];
+    }
+}
+
+void Triangular::TriangleGrid::reset(float xmin, float ymin, float extent, int side) {
+    this->xmin = xmin;
+    this->ymin = ymin;
+    this->side = side;
+    scale = extent > 0 ? side / extent : 0.f;
+    cells.assign(side * side, -1);
+}
+
+int& Triangular::TriangleGrid::at(const Node& p) {
+    // Clamped before the conversion, the point may lie far outside. NaN goes to the first cell.
+    float cx = (p.x - xmin) * scale, cy = (p.y - ymin) * scale;
+    cx = cx > 0 ? min(cx, float(side - 1)) : 0.f;
+    cy = cy > 0 ? min(cy, float(side - 1)) : 0.f;
+    return cells[static_cast<int>(cy) * side + static_cast<int>(cx)];
+}
+
+void Triangular::buildLocateGrid(float xmin, float ymin, float dmax) {
+    // Every cell gets the last triangle with its centroid in it, empty cells that of the nearest
+    // cell with one, spreading out breadth first
+    int side = max(1, static_cast<int>(std::sqrt(triangles.size() / 8.0)));
+    locateGrid.reset(xmin, ymin, dmax, side);
+    for (int t = 0; t < static_cast<int>(triangles.size()); t++) {
+        Node a = points[triangles[t].vertices[0]], b = points[triangles[t].vertices[1]], c = points[triangles[t].vertices[2]];
+        locateGrid.at({ (a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3 }) = t;
+    }
+    vector<int> queue;
+    for (int cell = 0; cell < side * side; cell++) {
+        if (locateGrid.cells[cell] >= 0) queue.push_back(cell);
+    }
+    for (std::size_t next = 0; next < queue.size(); next++) {
+        int cell = queue[next], cx = cell % side, cy = cell / side;
+        int neighbours[4][2] = { { cx - 1, cy }, { cx + 1, cy }, { cx, cy - 1 }, { cx, cy + 1 } };
+        for (auto& n : neighbours) {
+            if (n[0] < 0 || n[0] >= side || n[1] < 0 || n[1] >= side) continue;
+            int& neighbour = locateGrid.cells[n[1] * side + n[0]];
+            if (neighbour < 0) {
+                neighbour = locateGrid.cells[cell];
+                queue.push_back(n[1] * side + n[0]);
+            }
+        }
+    }
+}
+
+void Triangular::buildBoundary() {
+    boundaryEdges.clear();
+    lower = upper = points.empty() ? Node{} : points[0];
+    for (const Node& p : points) {
+        lower = { min(lower.x, p.x), min(lower.y, p.y) };
+        upper = { max(upper.x, p.x), max(upper.y, p.y) };
+    }
+    for (const Triangle& t : triangles) {
+        for (int k = 0; k < 3; k++) {
+            if (t.edges[k] < 0) boundaryEdges.push_back({ t.vertices[k], t.vertices[(k + 1) % 3] });
+        }
+    }
+}
+
+bool Triangular::withinBoundary(const Node& p) {
+    if (p.x < lower.x || p.y < lower.y || p.x > upper.x || p.y > upper.y) return false;
+
+    // Boundary edges crossed by the ray from p towards +x, points on an edge count as inside
+    bool inside = false;
+    for (const auto& edge : boundaryEdges) {
+        const Node& a = points[edge[0]];
+        const Node& b = points[edge[1]];
+        if (a.x == p.x && a.y == p.y) return true;
+        if ((a.y > p.y) != (b.y > p.y)) {
+            double side = orient2d(a, b, p);
+            if (side == 0) return true;
+            if ((side > 0) == (b.y > a.y)) inside = !inside;
+        }
+        else if (a.y == p.y && b.y == p.y && (a.x < p.x) != (b.x < p.x)) {
+            return true;
+        }
+    }
+    return inside;
+}
+
+int Triangular::locate(Node p) {
+    // Every side test of a NaN comes out false, which would put it inside the first triangle
+    if (triangles.empty() || !std::isfinite(p.x) || !std::isfinite(p.y)) return -1;
+    int j = locateGrid.at(p);
+    int steps = 0;
+    while (j >= 0) {
+        if (++steps > static_cast<int>(triangles.size())) {
+            throw std::runtime_error("Point location does not terminate, a point is not finite");
+        }
+        const Triangle& t = triangles[j];
+        double S1 = sideOfEdge(points, t.vertices[0], t.vertices[1], p);
+        double S2 = sideOfEdge(points, t.vertices[1], t.vertices[2], p);
+        double S3 = sideOfEdge(points, t.vertices[2], t.vertices[0], p);
+
+        // Leaving through the boundary means p is outside
+        if ((S1 > 0) && (S1 >= S2) && (S1 >= S3)) j = t.edges[0];
+        else if ((S2 > 0) && (S2 >= S1) && (S2 >= S3)) j = t.edges[1];
+        else if ((S3 > 0) && (S3 >= S1) && (S3 >= S2)) j = t.edges[2];
+        else break;
+    }
+    locateWalks.add(steps);
+
+    // The super triangle can leave the boundary non-convex in places, and a walk that leaves
+    // through it next to such a pocket misses a p on the other side
+    if (j < 0 && withinBoundary(p)) {
+        for (int t = 0; t < static_cast<int>(triangles.size()); t++) {
+            const Triangle& candidate = triangles[t];
+            if (pointWithinTriangle(sideOfEdge(points, candidate.vertices[0], candidate.vertices[1], p),
+                    sideOfEdge(points, candidate.vertices[1], candidate.vertices[2], p),
+                    sideOfEdge(points, candidate.vertices[2], candidate.vertices[0], p))) {
+                return t;
+            }
+        }
+    }
+    return j;
 }
 
 void Triangular::printInformation() {
@@ -306,15 +544,20 @@ void Triangular::writeTecplotFile(const std::string& filename) {
 }
 
 
-void Triangular::delaunayTriangulate() {
+void Triangular::delaunayTriangulate(const std::string& output) {
     int npts = points.size();
+    for (int i = 0; i < npts; i++) {
+        if (!std::isfinite(points[i].x) || !std::isfinite(points[i].y)) {
+            throw std::runtime_error("Point " + std::to_string(i) + " is not finite");
+        }
+    }
 
     // Normalize points to (0,0) - (1,1) boundary
     float xmin = 0.f, ymin = 0.f, dmax = 0.f;
     normalizePoints(xmin, ymin, dmax);
 
     // Sort points by proximity
-    binSort();
+    sortPoints();
 
     // Add super triangle
     points.resize(npts + 3);
@@ -323,23 +566,49 @@ void Triangular::delaunayTriangulate() {
     points[npts + 2] = { 0, 100 };
     npts += 3;
 
-    // Create vertices and edges
+    // Create vertices and edges, in a pool holding the 2n + 1 triangles of the construction
     int ntri = 1;
-    triangles.resize(ntri);
-    triangles[0].vertices = { npts - 3, npts - 2, npts - 1 };
-    triangles[0].edges = { -1, -1, -1 };
+    triVertices.assign(2 * (npts - 3) + 1, {});
+    triEdges.assign(2 * (npts - 3) + 1, {});
+    triVertices[0] = { npts - 3, npts - 2, npts - 1 };
+    triEdges[0] = { -1, -1, -1 };
     vector<int> triStack(npts - 3);
     int triOnStack = -1;
 
+    // Cells of about 4 points, each holding a triangle around the last point inserted in it.
+    // Triangles keep the point through the flips, so the hint stays next to it.
+    TriangleGrid insertionGrid;
+    insertionGrid.reset(0.f, 0.f, 1.f, settings.jumpAndWalk ? max(1, static_cast<int>(std::sqrt((npts - 3) / 4.0))) : 0);
+    insertionWalks = {};
+    vector<bool> unused;    // duplicates, only allocated when there are any
+
     // Insert all points and triangulate one by one
     for (int i = 0; i < npts - 3; i++) {
         // Find triangle T which contains points[i]
-        // where ntri - 1 is last triangle created
-        int T = searchForTriangle(i, ntri - 1);
+        // from ntri - 1, the last triangle created, or the triangle of the cell when that is closer
+        int start = ntri - 1;
+        if (settings.jumpAndWalk) {
+            int hint = insertionGrid.at(points[i]);
+            if (hint >= 0 && i > 0) {
+                Node toHint = points[triVertices[hint][0]] - points[i], toLast = points[i - 1] - points[i];
+                if (toHint.dot(toHint) < toLast.dot(toLast)) start = hint;
+            }
+        }
+        int T = searchForTriangle(i, start);
+
+        // A point that is already a vertex would only add flat triangles
+        bool duplicate = false;
+        for (int v : triVertices[T]) duplicate |= points[v].x == points[i].x && points[v].y == points[i].y;
+        if (duplicate) {
+            if (unused.empty()) unused.assign(npts - 3, false);
+            unused[i] = true;
+            continue;
+        }
 
         // Create new triangles around point i
         ntri += 2;
         createNewTriangles(ntri, T, i, triOnStack, triStack);
+        if (settings.jumpAndWalk) insertionGrid.at(points[i]) = T;
 
         // Fix triangles in the stack
         emptyStack(triOnStack, i, triStack);
@@ -347,12 +616,15 @@ void Triangular::delaunayTriangulate() {
 
     // Remove Super Triangle vertices
     removeSuperTriangle(ntri);
+    if (!unused.empty()) removeUnusedPoints(unused);
 
     // Undo the mapping
     denormalizePoints(xmin, ymin, dmax);
+    buildLocateGrid(xmin, ymin, dmax);
+    buildBoundary();
 
     // Save to TecPlot data file
-    writeTecplotFile("Triangulation.dat");
+    if (!output.empty()) writeTecplotFile(output);
 
 }
 
@@ -2,46 +2,113 @@
 #define TRIANGULAR_H
 
 #include "geometry.h"
+#include <array>
 
-struct Triangle : Polygon {
-    Triangle() : Polygon(3, -1) {}
+struct Triangle {
+    std::array<int, 3> vertices = {};
+    std::array<int, 3> edges = { -1, -1, -1 };  // neighbouring triangles, -1 on the boundary
+};
+
+// Order in which the points are inserted, all from one linear-time radix sort
+enum class PointOrder {
+    Bins,       // serpentine rows of about n^(1/4) x n^(1/4) bins
+    Hilbert,    // Hilbert curve through a lattice of about n cells, consecutive points stay closer
+    Brio        // biased randomized insertion order: random rounds doubling in size, each along the
+                // Hilbert curve. Keeps walks and flips short for clustered or grid aligned clouds.
+};
+
+struct TriangulationSettings {
+    PointOrder order = PointOrder::Bins;
+    int numThreads = 0;     // for ordering large clouds, 0 uses every hardware thread
+    unsigned seed = 0;      // Brio only, picks the rounds
+    bool jumpAndWalk = true;    // start each walk near the point through a grid of recent triangles,
+                                // else from the last triangle created
+};
+
+// Visibility walks of point location, steps counting the triangles visited
+struct WalkStatistics {
+    long long walks = 0;
+    long long steps = 0;
+    int longest = 0;
+
+    void add(int walkSteps) {
+        walks++;
+        steps += walkSteps;
+        longest = max(longest, walkSteps);
+    }
+    double mean() const { return walks ? double(steps) / walks : 0.0; }
 };
 
 class Triangular : public Geometry {
 public:
 
     Triangular() : points({}) {};
-    Triangular(vector<Node> points) : points(points) {};
-    Triangular(std::string filename) {
+    Triangular(vector<Node> points, TriangulationSettings settings = {}) : points(points), settings(settings) {};
+    Triangular(std::string filename, TriangulationSettings settings = {}) : settings(settings) {
         readTecplotFile(filename);
     }
 
-    void delaunayTriangulate();
+    // Writes the triangulation to output afterwards, nothing when it is empty. Points given more
+    // than once are kept once, so getPoints may hold fewer points than were given. Throws
+    // std::runtime_error, before changing anything, when a point is not finite or the points
+    // span more than a float can hold.
+    void delaunayTriangulate(const std::string& output = "Triangulation.dat");
     void printInformation();
 
     vector<Node> getPoints() { return points; }
     vector<Triangle> getTriangles() { return triangles; }
 
+    // Triangle containing p, -1 outside of the triangulation or when p is not finite. Jumps to a triangle near p through a
+    // uniform grid over the triangulation and walks from there. A walk that leaves the
+    // triangulation while p lies within its boundary falls back to testing every triangle.
+    int locate(Node p);
+
+    WalkStatistics getInsertionWalks() { return insertionWalks; }
+    WalkStatistics getLocateWalks() { return locateWalks; }
+
     void writeTecplotFile(const std::string& filename);
     void readTecplotFile(const std::string& filename);
 
 private:
     vector<Node> points;
     vector<Triangle> triangles;
+    TriangulationSettings settings;
+
+    // Triangles under construction, vertex and neighbour records in separate flat arrays
+    vector<std::array<int, 3>> triVertices;
+    vector<std::array<int, 3>> triEdges;
+
+    // Square grid of side x side cells from (xmin, ymin), each holding a triangle near it or -1
+    struct TriangleGrid {
+        float xmin = 0, ymin = 0, scale = 0;    // cells per unit length
+        int side = 0;
+        vector<int> cells;
+
+        void reset(float xmin, float ymin, float extent, int side);
+        int& at(const Node& p);
+    };
+    TriangleGrid locateGrid;
+    vector<std::array<int, 2>> boundaryEdges;  // edges with no neighbour, counterclockwise
+    Node lower, upper;                          // bounding box of the points
+    WalkStatistics insertionWalks, locateWalks;
 
     // prep points 
     void normalizePoints(float& xmin, float& ymin, float& dmax);
     void denormalizePoints(float& xmin, float& ymin, float& dmax);
-    void binSort();
+    void sortPoints();
 
     // delaunay helper functions
     int edge(int L, int K);
     bool delanayCondition(Node P, Node v1, Node v2, Node v3);
-    bool pointWithinTriangle(float S1, float S2, float S3);
+    bool pointWithinTriangle(double S1, double S2, double S3);
     int searchForTriangle(int i, int j);
     void createNewTriangles(int ntri, int T, int i, int& triOnStack, vector<int>& triStack);
     void emptyStack(int& tos, int i, vector<int>& triStack);
     void removeSuperTriangle(int& ntri);
+    void removeUnusedPoints(const vector<bool>& unused);
+    void buildLocateGrid(float xmin, float ymin, float dmax);
+    void buildBoundary();
+    bool withinBoundary(const Node& p);
 
 };
 
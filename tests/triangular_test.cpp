@@ -0,0 +1,81 @@
+#include "triangular.h"
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+bool throwsRuntimeError(vector<Node> points) {
+    Triangular triangulation(points);
+    try {
+        triangulation.delaunayTriangulate("");
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+vector<Node> lattice(int side) {
+    vector<Node> points;
+    for (int j = 0; j < side; j++) {
+        for (int i = 0; i < side; i++) points.push_back({ float(i), float(j) });
+    }
+    return points;
+}
+
+void testNotFinite() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    for (Node bad : { Node{ nan, 1.f }, Node{ 1.f, nan }, Node{ inf, 1.f }, Node{ 1.f, -inf } }) {
+        vector<Node> points = lattice(10);
+        points.insert(points.begin() + 37, bad);
+        check(throwsRuntimeError(points), "a point that is not finite throws");
+    }
+    check(throwsRuntimeError({ { -3e38f, 0.f }, { 3e38f, 0.f }, { 0.f, 1.f } }),
+          "an extent beyond a float throws");
+}
+
+void testDuplicates() {
+    Triangular triangulation(vector<Node>(100, Node{ 2.5f, -4.f }));
+    triangulation.delaunayTriangulate("");
+    check(triangulation.getPoints().size() == 1, "identical points keep one");
+    check(triangulation.getTriangles().empty(), "identical points make no triangles");
+    check(triangulation.locate({ 2.5f, -4.f }) == -1, "nothing to locate in without triangles");
+
+    vector<Node> points = lattice(10), twice = lattice(10);
+    points.insert(points.end(), twice.begin(), twice.end());
+    Triangular doubled(points);
+    doubled.delaunayTriangulate("");
+    check(doubled.getPoints().size() == 100, "points given twice are kept once");
+    check(doubled.getTriangles().size() == 2 * 9 * 9, "points given twice triangulate once");
+}
+
+void testLocate() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    Triangular triangulation(lattice(10));
+    triangulation.delaunayTriangulate("");
+    check(triangulation.locate({ 4.5f, 4.25f }) >= 0, "a point inside is located");
+    check(triangulation.locate({ 9.5f, 4.f }) == -1, "a point outside is not");
+    check(triangulation.locate({ nan, 4.f }) == -1, "a NaN point is outside");
+    check(triangulation.locate({ 4.f, inf }) == -1, "an infinite point is outside");
+}
+
+}
+
+int main() {
+    testNotFinite();
+    testDuplicates();
+    testLocate();
+    if (failures) std::cerr << failures << " checks failed" << endl;
+    return failures ? 1 : 0;
+}